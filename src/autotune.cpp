@@ -0,0 +1,275 @@
+/*
+ *  This file is part of Lime, a tool for the application of Likhtman & McLiesh' model for polymer dyanmics.
+ *
+ *  Copyright © 2020 Daniel Emmery (CNRS)
+ *
+ *  File contents:
+ *
+ *  Selection of the parallelization strategy and chunk size of every kernel from its measured cost
+ *
+ *  GPL 3.0 License
+ *
+ */
+
+#include "autotune.hpp"
+#include "lime_log_utils.hpp"
+
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <limits>
+#include <sstream>
+
+namespace
+{
+    // Rough cost of handing a task to another thread, in seconds
+    constexpr double task_overhead = 5e-6;
+
+    // Tasks get at least this much work, so the overhead stays a few percent of it
+    constexpr double task_work = 100.0 * task_overhead;
+
+    // Tasks per thread, so threads that finish early can take over work of others
+    constexpr size_t tasks_per_thread = 4;
+
+    size_t
+    divide_up(size_t numerator, size_t denominator)
+    {
+        return (numerator + denominator - 1) / denominator;
+    }
+}
+
+std::ostream&
+operator<<(std::ostream& stream, Kernel_strategy strategy)
+{
+    switch (strategy)
+    {
+        case Kernel_strategy::SEQUENTIAL:
+            return stream << "sequential";
+        case Kernel_strategy::OVER_TIME:
+            return stream << "over_time";
+        case Kernel_strategy::OVER_INNER:
+            return stream << "over_inner";
+    }
+
+    return stream;
+}
+
+Kernel_tuning
+decide_strategy(double cost, size_t size, size_t inner, size_t threads, double regions)
+{
+    const double work = cost * static_cast<double>(size);
+
+    if (threads <= 1 or size == 0 or work < task_work)
+    {
+        return Kernel_tuning{Kernel_strategy::SEQUENTIAL, std::max<size_t>(size, 1)};
+    }
+
+    // Too few points to keep every thread busy, while every split of a point holds enough work to spread
+    const double region_cost = cost / std::max(regions, 1.0);
+
+    if (inner >= threads and size < threads and region_cost / static_cast<double>(threads) >= task_work)
+    {
+        return Kernel_tuning{Kernel_strategy::OVER_INNER, divide_up(inner, tasks_per_thread * threads)};
+    }
+
+    const size_t by_work = static_cast<size_t>(std::ceil(task_work / std::max(cost, std::numeric_limits<double>::min())));
+    const size_t by_balance = std::max<size_t>(1, size / (tasks_per_thread * threads));
+
+    return Kernel_tuning{Kernel_strategy::OVER_TIME, std::clamp<size_t>(by_work, 1, by_balance)};
+}
+
+Autotuner&
+Autotuner::get()
+{
+    static Autotuner tuner;
+    return tuner;
+}
+
+void
+Autotuner::set_profile(std::filesystem::path path)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    path_ = path;
+
+    std::ifstream file(path);
+
+    // Nothing measured yet
+    if (not file)
+    {
+        return;
+    }
+
+    std::string line;
+    size_t line_number{0};
+
+    while (std::getline(file, line))
+    {
+        ++line_number;
+
+        if (line.empty() or line.front() == '#')
+        {
+            continue;
+        }
+
+        std::istringstream stream(line);
+        std::string kernel;
+        double cost, regions;
+
+        // The decisions stored after the cost are only informative, they are made anew for every grid
+        if (stream >> kernel >> cost >> regions and cost >= 0.0 and regions >= 0.0)
+        {
+            auto& profile = profiles_.try_emplace(kernel, kernel).first->second;
+            profile.cost.store(cost);
+            profile.regions.store(std::max(regions, 1.0));
+        }
+        else
+        {
+            BOOST_LOG_TRIVIAL(warning) << "Skipping unreadable line " << line_number << " of tuning profile " << path;
+        }
+    }
+}
+
+Autotuner::Profile&
+Autotuner::profile(std::string_view kernel)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    const auto found = profiles_.find(kernel);
+
+    if (found != profiles_.end())
+    {
+        return found->second;
+    }
+
+    return profiles_.try_emplace(std::string(kernel), kernel).first->second;
+}
+
+std::optional<double>
+Autotuner::cost(std::string_view kernel) const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    const auto profile = profiles_.find(kernel);
+
+    if (profile == profiles_.end() or profile->second.cost.load() < 0.0)
+    {
+        return std::nullopt;
+    }
+
+    return profile->second.cost.load();
+}
+
+void
+Autotuner::record_cost(Profile& profile, double seconds, double regions)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    // Stored before the cost, which marks the profile as measured
+    profile.regions.store(std::max(regions, 1.0));
+    profile.cost.store(seconds);
+
+    BOOST_LOG_TRIVIAL(debug) << "Kernel " << profile.name << " takes " << seconds << " s per time point, in " << std::max(regions, 1.0) << " splits.";
+
+    save();
+}
+
+Kernel_tuning
+Autotuner::tune(Profile& profile, size_t size, size_t inner)
+{
+    const double cost = profile.cost.load(std::memory_order_relaxed);
+
+    // Nothing was probed, which happens when the first range was empty, so the kernel stays unmeasured
+    if (cost < 0.0)
+    {
+        return Kernel_tuning{Kernel_strategy::SEQUENTIAL, std::max<size_t>(size, 1)};
+    }
+
+    const size_t threads = Execution_context::get().num_threads();
+    const auto tuning = decide_strategy(cost, size, inner, threads, profile.regions.load(std::memory_order_relaxed));
+
+    // Repeated evaluations make the same decision, only a different one is recorded. A collision of keys only skips that.
+    const std::uint64_t key = (static_cast<std::uint64_t>(size) * 0x9E3779B97F4A7C15ull) ^ (static_cast<std::uint64_t>(tuning.chunk) << 2)
+                              ^ static_cast<std::uint64_t>(tuning.strategy);
+
+    // Concurrent fits share the profile, a load keeps its cache line shared between them
+    if (profile.last_decision.load(std::memory_order_relaxed) == key)
+    {
+        return tuning;
+    }
+
+    profile.last_decision.store(key, std::memory_order_relaxed);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    const auto [last, inserted] = profile.decisions.try_emplace(size, tuning);
+    const bool changed = inserted or last->second.strategy != tuning.strategy or last->second.chunk != tuning.chunk;
+    last->second = tuning;
+
+    if (changed)
+    {
+        BOOST_LOG_TRIVIAL(debug) << "Kernel " << profile.name << " on " << size << " points with " << threads << " threads: "
+                                 << tuning.strategy << ", chunks of " << tuning.chunk << ".";
+    }
+
+    return tuning;
+}
+
+void
+Autotuner::reset()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    for (auto& [kernel, profile] : profiles_)
+    {
+        profile.cost.store(-1.0);
+        profile.regions.store(1.0);
+        profile.last_decision.store(std::numeric_limits<std::uint64_t>::max());
+        profile.decisions.clear();
+    }
+}
+
+Autotuner::~Autotuner()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    save();
+}
+
+void
+Autotuner::save() const
+{
+    if (not path_)
+    {
+        return;
+    }
+
+    std::ofstream file(*path_);
+
+    if (not file)
+    {
+        BOOST_LOG_TRIVIAL(warning) << "Could not write tuning profile " << *path_;
+        return;
+    }
+
+    file << "# kernel, seconds per time point, splits of the inner work per time point, then per grid size: size, last strategy, last chunk size\n";
+
+    for (const auto& [kernel, profile] : profiles_)
+    {
+        const double cost = profile.cost.load();
+
+        if (cost < 0.0)
+        {
+            continue;
+        }
+
+        file << kernel << ' ' << std::setprecision(std::numeric_limits<double>::max_digits10) << cost << ' ' << profile.regions.load();
+
+        for (const auto& [size, tuning] : profile.decisions)
+        {
+            file << ' ' << size << ' ' << tuning.strategy << ' ' << tuning.chunk;
+        }
+
+        file << '\n';
+    }
+}
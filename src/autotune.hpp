@@ -0,0 +1,198 @@
+#pragma once
+
+/*
+ *  This file is part of Lime, a tool for the application of Likhtman & McLiesh' model for polymer dyanmics.
+ *
+ *  Copyright © 2020 Daniel Emmery (CNRS)
+ *
+ *  File contents:
+ *
+ *  Selection of the parallelization strategy and chunk size of every kernel from its measured cost
+ *
+ *  GPL 3.0 License
+ *
+ */
+
+#include "parallel_policy.hpp"
+
+#include <boost/iterator/counting_iterator.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <iosfwd>
+#include <iterator>
+#include <limits>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+
+enum class Kernel_strategy
+{
+    SEQUENTIAL,
+    // Chunks of time points are spread over the threads
+    OVER_TIME,
+    // Time points are evaluated one after the other, the work within each one is spread over the threads
+    OVER_INNER
+};
+
+std::ostream& operator<<(std::ostream& stream, Kernel_strategy strategy);
+
+struct Kernel_tuning
+{
+    Kernel_strategy strategy;
+    // Time points per task for OVER_TIME, inner work items per task for OVER_INNER
+    size_t chunk;
+};
+
+// Costs per time point are measured on the first call of every kernel, or read from a profile of earlier runs.
+// From the cost, the number of points, the inner work per point and the threads available, the tuner picks how
+// to spread the evaluation. Decisions are made per kernel and grid size, and logged at debug level when they change.
+// The profile is written when a cost is measured and once more at exit, with the last decisions.
+class Autotuner
+{
+    public:
+        // Cost and decisions of one kernel. Profiles are never removed, so call sites keep a reference (see Kernel_id)
+        // and evaluations read the cost and compare their decision without taking the tuner's lock.
+        struct Profile
+        {
+            explicit Profile(std::string_view kernel) : name{kernel} {}
+
+            const std::string name;
+            // Seconds per time point, negative while not measured
+            std::atomic<double> cost{-1.0};
+            // Times a point splits its inner work, each split costs a share of the point
+            std::atomic<double> regions{1.0};
+            // Key of the last decision, the lock is only taken when it changes
+            std::atomic<std::uint64_t> last_decision{std::numeric_limits<std::uint64_t>::max()};
+            // By the number of time points, guarded by the tuner's lock
+            std::map<size_t, Kernel_tuning> decisions;
+        };
+
+        static Autotuner& get();
+
+        // Reads the costs stored at path, if there are any, and writes new measurements to it
+        void set_profile(std::filesystem::path path);
+
+        // Profile of kernel, created unmeasured on first use
+        Profile& profile(std::string_view kernel);
+
+        // Seconds per time point
+        std::optional<double> cost(std::string_view kernel) const;
+        // regions is the number of times a point split its inner work, 0 if it didn't
+        void record_cost(Profile& profile, double seconds, double regions = 0.0);
+
+        // inner is the number of independent work items within one time point, 0 if it can't be split
+        Kernel_tuning tune(Profile& profile, size_t size, size_t inner);
+
+        // Drops all costs and decisions, the profile is left as it is
+        void reset();
+
+        ~Autotuner();
+
+    private:
+        Autotuner() = default;
+
+        mutable std::mutex mutex_;
+        std::optional<std::filesystem::path> path_;
+        std::map<std::string, Profile, std::less<>> profiles_;
+
+        // Expects mutex_ to be held
+        void save() const;
+};
+
+// Names a kernel, whose profile is looked up once. Declared static where the kernel is evaluated.
+class Kernel_id
+{
+    public:
+        explicit Kernel_id(std::string_view kernel) : profile_{&Autotuner::get().profile(kernel)} {}
+
+        Autotuner::Profile& profile() const { return *profile_; }
+
+    private:
+        Autotuner::Profile* profile_;
+};
+
+// Decision for a kernel of cost seconds per point, without any state. A point splits its inner work regions times,
+// every split has to pay for starting the tasks by itself.
+Kernel_tuning decide_strategy(double cost, size_t size, size_t inner, size_t threads, double regions = 1.0);
+
+// out[i] = func(*(first + i)) over [first, last), spread as tuned for kernel. While the cost of the kernel isn't
+// known yet, the leading points are evaluated in sequence and timed. set_inner_chunk(chunk) is called around the
+// rest of the evaluation if the work within points is spread, with 0 afterwards. count_regions() returns how
+// often the kernel split its inner work so far, which the timed points use to find the cost of one split.
+template <typename In, typename Out, typename F, typename Set_inner = void(*)(size_t), typename Count_regions = size_t(*)()>
+Kernel_tuning
+tuned_transform(const Kernel_id& kernel, In first, In last, Out out, F func, size_t inner = 0, Set_inner set_inner_chunk = [](size_t) {},
+    Count_regions count_regions = []() { return size_t{0}; })
+{
+    using clock = std::chrono::steady_clock;
+
+    // Enough to time reliably, little enough to not matter if the kernel should have been parallel
+    static constexpr std::chrono::microseconds probe_time{500};
+    static constexpr size_t probe_points = 8;
+
+    auto& tuner = Autotuner::get();
+    auto& profile = kernel.profile();
+    const size_t size = static_cast<size_t>(std::distance(first, last));
+    size_t done{0};
+
+    if (profile.cost.load(std::memory_order_relaxed) < 0.0)
+    {
+        const size_t first_region = count_regions();
+        const auto start = clock::now();
+
+        while (done < size and done < probe_points and clock::now() - start < probe_time)
+        {
+            *(out + done) = func(*(first + done));
+            ++done;
+        }
+
+        if (done > 0)
+        {
+            tuner.record_cost(profile, std::chrono::duration<double>(clock::now() - start).count() / static_cast<double>(done),
+                              static_cast<double>(count_regions() - first_region) / static_cast<double>(done));
+        }
+    }
+
+    const auto tuning = tuner.tune(profile, size - done, inner);
+
+    first += done;
+    out += done;
+
+    switch (tuning.strategy)
+    {
+        case Kernel_strategy::SEQUENTIAL:
+            std::transform(first, last, out, func);
+            break;
+
+        case Kernel_strategy::OVER_INNER:
+            set_inner_chunk(tuning.chunk);
+            std::transform(first, last, out, func);
+            set_inner_chunk(0);
+            break;
+
+        case Kernel_strategy::OVER_TIME:
+        {
+            const size_t remaining = size - done;
+            const boost::counting_iterator<size_t> first_chunk(0), last_chunk((remaining + tuning.chunk - 1) / tuning.chunk);
+
+            // Kernels are guarded by an Error_channel
+            std::for_each(sync_exec_policy, first_chunk, last_chunk, [&](size_t chunk) {
+                const size_t begin = chunk * tuning.chunk;
+                const size_t end = std::min(begin + tuning.chunk, remaining);
+
+                std::transform(first + begin, first + end, out + begin, func);
+            });
+
+            break;
+        }
+    }
+
+    return tuning;
+}
@@ -0,0 +1,301 @@
+/*
+ *  This file is part of Lime, a tool for the application of Likhtman & McLiesh' model for polymer dyanmics.
+ *
+ *  Copyright © 2020 Daniel Emmery (CNRS)
+ *
+ *  File contents:
+ *
+ *  Evaluation of the ICS model for many parameter sets at once
+ *
+ *  GPL 3.0 License
+ *
+ */
+
+#include "batch.hpp"
+#include "contour_length_fluctuations.hpp"
+#include "tube.hpp"
+#include "utilities.hpp"
+#include "parallel_policy.hpp"
+#include "error_channel.hpp"
+
+#include <boost/math/special_functions/gamma.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+
+namespace
+{
+    // Sets evaluated side by side, as many doubles as the widest vector registers hold
+    constexpr size_t lane_count = 8;
+
+    // Time points per tile, which keeps the rows a tile writes in the L1 cache
+    constexpr size_t time_block = 64;
+
+    // Upper incomplete gamma function of order -1/4
+    double
+    upper_gamma_negative_quarter(double x)
+    {
+        constexpr double a = -0.25;
+
+        // Integration by parts leads to a positive order, which cancels badly for large x
+        if (x <= 1.0)
+        {
+            return 4.0 * (std::pow(x, a) * std::exp(-x) - boost::math::tgamma(0.75, x));
+        }
+
+        // Continued fraction, evaluated with the modified Lentz method
+        constexpr double tiny = std::numeric_limits<double>::min() / std::numeric_limits<double>::epsilon();
+
+        double b = x + 1.0 - a;
+        double c = 1.0 / tiny;
+        double d = 1.0 / b;
+        double h = d;
+
+        for (int i = 1 ; i < 1000 ; ++i)
+        {
+            const double an = -i * (i - a);
+            b += 2.0;
+
+            d = an * d + b;
+            if (std::abs(d) < tiny)
+                d = tiny;
+
+            c = b + an / c;
+            if (std::abs(c) < tiny)
+                c = tiny;
+
+            d = 1.0 / d;
+            const double delta = d * c;
+            h *= delta;
+
+            if (std::abs(delta - 1.0) < std::numeric_limits<double>::epsilon())
+                break;
+        }
+
+        return std::exp(-x + a * std::log(x)) * h;
+    }
+
+    // Closed form of the integral the contour length fluctuations compute by quadrature,
+    // int_{lower}^{inf} epsilon^(-5/4) exp(-epsilon t) d epsilon
+    double
+    clf_integral(double lower, double t)
+    {
+        if (t <= 0.0)
+        {
+            return 4.0 * std::pow(lower, -0.25);
+        }
+
+        return std::pow(t, 0.25) * upper_gamma_negative_quarter(lower * t);
+    }
+}
+
+size_t
+Parameter_batch::size() const
+{
+    return Z.size();
+}
+
+void
+Parameter_batch::push_back(const Context& ctx, double c_v_)
+{
+    Z.push_back(ctx.Z);
+    tau_e.push_back(ctx.tau_e);
+    G_e.push_back(ctx.G_e);
+    c_v.push_back(c_v_);
+    N.push_back(ctx.N);
+}
+
+void
+Parameter_batch::validate() const
+{
+    const size_t k = size();
+
+    if (tau_e.size() != k or G_e.size() != k or c_v.size() != k or N.size() != k)
+    {
+        throw std::runtime_error("The parameter arrays of a batch differ in length.");
+    }
+}
+
+Batch_evaluator::Batch_evaluator(Time_series::time_type time_range, constraint_release::impl impl)
+:   time_range_{time_range}, impl_{impl}
+{
+    if (impl_ == constraint_release::impl::RUBINSTEINCOLBY)
+    {
+        throw std::runtime_error("Batched evaluation doesn't support Rubinstein & Colby constraint release.");
+    }
+}
+
+size_t
+Batch_evaluator::time_points() const
+{
+    return time_range_->size();
+}
+
+Batch_evaluator::Lanes
+Batch_evaluator::prepare(const Parameter_batch& batch) const
+{
+    batch.validate();
+
+    const size_t k = batch.size();
+
+    Lanes lanes;
+    lanes.Z = batch.Z;
+    lanes.G_e = batch.G_e;
+    lanes.N = batch.N;
+    lanes.G_f_normed.resize(k);
+    lanes.tau_r.resize(k);
+    lanes.tau_df.resize(k);
+    lanes.e_star.resize(k);
+    lanes.clf_norm.resize(k);
+
+    if (impl_ == constraint_release::impl::HEUZEY)
+    {
+        lanes.heuzey.reserve(k);
+    }
+
+    for (size_t i = 0 ; i < k ; ++i)
+    {
+        // The same physics the ICS context builder applies
+        Context ctx;
+        ctx.Z = batch.Z[i];
+        ctx.tau_e = batch.tau_e[i];
+
+        G_f_normed{}.apply(ctx);
+        Tau_r{}.apply(ctx);
+        Tau_d_0{}.apply(ctx);
+        Tau_df{}.apply(ctx);
+
+        lanes.G_f_normed[i] = ctx.G_f_normed;
+        lanes.tau_r[i] = ctx.tau_r;
+        lanes.tau_df[i] = ctx.tau_df;
+        lanes.e_star[i] = Contour_length_fluctuations::e_star(ctx.Z, ctx.tau_e, ctx.G_f_normed);
+        lanes.clf_norm[i] = Contour_length_fluctuations::norm(ctx.Z, ctx.tau_e);
+
+        if (impl_ == constraint_release::impl::HEUZEY)
+        {
+            lanes.heuzey.emplace_back(batch.c_v[i], ctx.Z, ctx.tau_e, ctx.tau_df);
+        }
+    }
+
+    return lanes;
+}
+
+std::vector<double>
+Batch_evaluator::evaluate(const Parameter_batch& batch) const
+{
+    std::vector<double> result(batch.size() * time_points());
+
+    evaluate(batch, result.data());
+
+    return result;
+}
+
+void
+Batch_evaluator::evaluate(const Parameter_batch& batch, double* out) const
+{
+    const Lanes lanes = prepare(batch);
+
+    const size_t sets = batch.size();
+    const size_t times = time_points();
+
+    const size_t set_tiles = (sets + lane_count - 1) / lane_count;
+    const size_t time_tiles = (times + time_block - 1) / time_block;
+
+    std::vector<size_t> tiles(set_tiles * time_tiles);
+    std::iota(tiles.begin(), tiles.end(), 0);
+
+    Error_channel errors;
+
+    with_sync_policy(sets * times, [&](const auto& policy) {
+        std::for_each(policy, tiles.begin(), tiles.end(), errors.guard([&](size_t tile) {
+            const size_t first_set = (tile / time_tiles) * lane_count;
+            const size_t first_time = (tile % time_tiles) * time_block;
+
+            evaluate_tile(lanes, first_set, std::min(first_set + lane_count, sets), first_time, std::min(first_time + time_block, times), out);
+        }));
+    });
+
+    errors.rethrow_if_failed();
+}
+
+// The sums run over the same modes in the same order as Contour_length_fluctuations, Longitudinal_motion and
+// Rouse_motion, lanes past their last mode add nothing
+void
+Batch_evaluator::evaluate_tile(const Lanes& lanes, size_t first_set, size_t last_set, size_t first_time, size_t last_time, double* out) const
+{
+    using lane_t = std::array<double, lane_count>;
+
+    const size_t width = last_set - first_set;
+    const size_t times = time_points();
+
+    lane_t clf_modes{}, longitudinal_modes{}, rouse_last{};
+    double clf_max{0.0}, longitudinal_max{0.0}, rouse_max{0.0};
+
+    for (size_t l = 0 ; l < width ; ++l)
+    {
+        const size_t k = first_set + l;
+
+        clf_modes[l] = std::sqrt(lanes.Z[k]/10.0);
+        longitudinal_modes[l] = lanes.Z[k] - 1.0;
+        rouse_last[l] = lanes.N[k];
+
+        clf_max = std::max(clf_max, clf_modes[l]);
+        longitudinal_max = std::max(longitudinal_max, longitudinal_modes[l]);
+        rouse_max = std::max(rouse_max, rouse_last[l]);
+    }
+
+    for (size_t i = first_time ; i < last_time ; ++i)
+    {
+        const double t = (*time_range_)[i];
+
+        lane_t clf_sum{}, longitudinal_sum{}, rouse_sum{};
+
+        for (double p = 1.0 ; p <= clf_max ; p += 2.0)
+        {
+            for (size_t l = 0 ; l < width ; ++l)
+            {
+                const double term = 1.0/square(p) * std::exp( -t*square(p)/lanes.tau_df[first_set + l] );
+                clf_sum[l] += (p <= clf_modes[l]) ? term : 0.0;
+            }
+        }
+
+        for (double p = 1.0 ; p <= longitudinal_max ; p += 1.0)
+        {
+            for (size_t l = 0 ; l < width ; ++l)
+            {
+                const double term = std::exp(-square(p) * t / lanes.tau_r[first_set + l]);
+                longitudinal_sum[l] += (p <= longitudinal_modes[l]) ? term : 0.0;
+            }
+        }
+
+        // Rouse modes start at Z, which differs between lanes
+        lane_t p;
+        std::copy(lanes.Z.begin() + first_set, lanes.Z.begin() + last_set, p.begin());
+
+        for (double mode = *std::min_element(p.begin(), p.begin() + width) ; mode <= rouse_max ; mode += 1.0)
+        {
+            for (size_t l = 0 ; l < width ; ++l)
+            {
+                const double term = std::exp(-2.0 * square(p[l]) * t / lanes.tau_r[first_set + l]);
+                rouse_sum[l] += (p[l] <= rouse_last[l]) ? term : 0.0;
+                p[l] += 1.0;
+            }
+        }
+
+        for (size_t l = 0 ; l < width ; ++l)
+        {
+            const size_t k = first_set + l;
+
+            const double clf = lanes.G_f_normed[k] * clf_sum[l] + (clf_integral(lanes.e_star[k], t)*0.306)/lanes.clf_norm[k];
+            const double cr = (impl_ == constraint_release::impl::HEUZEY) ? lanes.heuzey[k](t) : clf;
+            const double longitudinal = longitudinal_sum[l] / (5.0 * lanes.Z[k]);
+            const double rouse = rouse_sum[l] / lanes.Z[k];
+
+            out[k * times + i] = lanes.G_e[k] * (4.0/5.0 * cr * clf + longitudinal + rouse);
+        }
+    }
+}
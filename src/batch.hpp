@@ -0,0 +1,78 @@
+#pragma once
+
+/*
+ *  This file is part of Lime, a tool for the application of Likhtman & McLiesh' model for polymer dyanmics.
+ *
+ *  Copyright © 2020 Daniel Emmery (CNRS)
+ *
+ *  File contents:
+ *
+ *  Evaluation of the ICS model for many parameter sets at once
+ *
+ *  GPL 3.0 License
+ *
+ */
+
+#include "context.hpp"
+#include "time_series.hpp"
+#include "constraint_release/constraint_release.hpp"
+#include "constraint_release/heuzey.hpp"
+
+#include <vector>
+
+// Parameter sets in structure of arrays layout, set k is made of the k-th element of every array
+struct Parameter_batch
+{
+    std::vector<double> Z;
+    std::vector<double> tau_e;
+    std::vector<double> G_e;
+    std::vector<double> c_v;
+    // Chain length, the Rouse modes run from Z to N
+    std::vector<double> N;
+
+    size_t size() const;
+
+    // Appends the set of a context after its physics were applied
+    void push_back(const Context& ctx, double c_v);
+
+    // Throws if the arrays differ in length
+    void validate() const;
+};
+
+// Evaluates G(t) of the ICS model like ICS_result, for every set of a batch. Sets are processed in groups of lanes,
+// whose mode sums and contour length fluctuations are computed side by side over the arrays, so they vectorize
+// across sets. Groups of lanes and blocks of time points form tiles, which are evaluated in parallel and keep the
+// per set constants and the written rows in cache.
+// Heuzey's constraint release is integrated per set, Rubinstein & Colby's random spectra are not supported.
+class Batch_evaluator
+{
+    public:
+        Batch_evaluator(Time_series::time_type time_range, constraint_release::impl impl);
+
+        // Fills out with batch.size() rows of one value per time point, row major
+        void evaluate(const Parameter_batch& batch, double* out) const;
+        std::vector<double> evaluate(const Parameter_batch& batch) const;
+
+        size_t time_points() const;
+
+    private:
+        // Per set constants, in the same layout as the batch
+        struct Lanes
+        {
+            std::vector<double> Z;
+            std::vector<double> G_e;
+            std::vector<double> N;
+            std::vector<double> G_f_normed;
+            std::vector<double> tau_r;
+            std::vector<double> tau_df;
+            std::vector<double> e_star;
+            std::vector<double> clf_norm;
+            std::vector<HEU_constraint_release> heuzey;
+        };
+
+        Lanes prepare(const Parameter_batch& batch) const;
+        void evaluate_tile(const Lanes& lanes, size_t first_set, size_t last_set, size_t first_time, size_t last_time, double* out) const;
+
+        Time_series::time_type time_range_;
+        constraint_release::impl impl_;
+};
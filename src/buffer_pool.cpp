@@ -0,0 +1,175 @@
+/*
+ *  This file is part of Lime, a tool for the application of Likhtman & McLiesh' model for polymer dyanmics.
+ *
+ *  Copyright © 2020 Daniel Emmery (CNRS)
+ *
+ *  File contents:
+ *
+ *  Pool of 64 byte aligned buffers, recycled per size and per thread, backing the values of time series
+ *
+ *  GPL 3.0 License
+ *
+ */
+
+#include "buffer_pool.hpp"
+
+#include <atomic>
+#include <unordered_map>
+#include <vector>
+
+namespace
+{
+    // Per size, more buffers than this are freed, which bounds the memory a thread holds on to
+    constexpr std::size_t max_free_buffers = 16;
+
+    std::atomic<bool> pool_enabled{false};
+    std::atomic<std::size_t> pool_scopes{0};
+
+#ifdef POOL_STATISTICS
+    std::atomic<std::size_t> allocated_count{0};
+    std::atomic<std::size_t> reused_count{0};
+    std::atomic<std::size_t> released_count{0};
+#endif
+
+    void*
+    allocate_aligned(std::size_t bytes)
+    {
+        return ::operator new(bytes, std::align_val_t{Buffer_pool::alignment});
+    }
+
+    void
+    free_aligned(void* buffer) noexcept
+    {
+        ::operator delete(buffer, std::align_val_t{Buffer_pool::alignment});
+    }
+
+    // Buffers are sized in whole cache lines
+    std::size_t
+    rounded(std::size_t bytes)
+    {
+        return (bytes + Buffer_pool::alignment - 1) / Buffer_pool::alignment * Buffer_pool::alignment;
+    }
+
+    // Trivially destructible, so it can still be read while thread local objects are destroyed
+    thread_local bool free_lists_destroyed{false};
+
+    struct Free_lists
+    {
+        std::unordered_map<std::size_t, std::vector<void*>> by_size;
+
+        ~Free_lists()
+        {
+            free_lists_destroyed = true;
+
+            for (auto& [bytes, buffers] : by_size)
+            {
+                for (void* buffer : buffers)
+                {
+                    free_aligned(buffer);
+                }
+            }
+        }
+    };
+
+    // Null once the thread is exiting, buffers freed after that are freed right away
+    Free_lists*
+    free_lists()
+    {
+        if (free_lists_destroyed)
+        {
+            return nullptr;
+        }
+
+        thread_local Free_lists lists;
+        return &lists;
+    }
+}
+
+void
+Buffer_pool::set_enabled(bool enabled)
+{
+    pool_enabled.store(enabled);
+}
+
+bool
+Buffer_pool::enabled()
+{
+    return pool_enabled.load(std::memory_order_relaxed) or pool_scopes.load(std::memory_order_relaxed) > 0;
+}
+
+Buffer_pool::Scope::Scope()
+{
+    pool_scopes.fetch_add(1);
+}
+
+Buffer_pool::Scope::~Scope()
+{
+    pool_scopes.fetch_sub(1);
+}
+
+void*
+Buffer_pool::allocate(std::size_t bytes)
+{
+    bytes = rounded(bytes);
+
+    if (auto lists = enabled() ? free_lists() : nullptr)
+    {
+        auto& buffers = lists->by_size[bytes];
+
+        if (not buffers.empty())
+        {
+            void* buffer = buffers.back();
+            buffers.pop_back();
+
+#ifdef POOL_STATISTICS
+            reused_count.fetch_add(1, std::memory_order_relaxed);
+#endif
+            return buffer;
+        }
+    }
+
+#ifdef POOL_STATISTICS
+    allocated_count.fetch_add(1, std::memory_order_relaxed);
+#endif
+
+    return allocate_aligned(bytes);
+}
+
+void
+Buffer_pool::deallocate(void* buffer, std::size_t bytes) noexcept
+{
+    bytes = rounded(bytes);
+
+#ifdef POOL_STATISTICS
+    released_count.fetch_add(1, std::memory_order_relaxed);
+#endif
+
+    if (auto lists = enabled() ? free_lists() : nullptr)
+    {
+        try
+        {
+            auto& buffers = lists->by_size[bytes];
+
+            if (buffers.size() < max_free_buffers)
+            {
+                buffers.push_back(buffer);
+                return;
+            }
+        }
+        catch (const std::bad_alloc&)
+        {
+        }
+    }
+
+    free_aligned(buffer);
+}
+
+Buffer_pool::Statistics
+Buffer_pool::statistics()
+{
+#ifdef POOL_STATISTICS
+    return Statistics{allocated_count.load(), reused_count.load(), released_count.load()};
+#else
+    return Statistics{0, 0, 0};
+#endif
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+/*
+ *  This file is part of Lime, a tool for the application of Likhtman & McLiesh' model for polymer dyanmics.
+ *
+ *  Copyright © 2020 Daniel Emmery (CNRS)
+ *
+ *  File contents:
+ *
+ *  Pool of 64 byte aligned buffers, recycled per size and per thread, backing the values of time series
+ *
+ *  GPL 3.0 License
+ *
+ */
+
+#include <cstddef>
+#include <new>
+
+// Fits and sweeps evaluate many results of the same size, whose values are freed and allocated over and over.
+// While enabled, freed buffers are kept on a free list of the freeing thread, per size, and handed out again.
+// Buffers are aligned to cache lines, so values can be loaded with the widest SIMD instructions.
+struct Buffer_pool
+{
+    static constexpr std::size_t alignment = 64;
+
+    struct Statistics
+    {
+        std::size_t allocated;
+        std::size_t reused;
+        std::size_t released;
+    };
+
+    // Disabled by default, buffers are then freed right away
+    static void set_enabled(bool enabled);
+    // Enabled if set_enabled(true) was called or a Scope is alive
+    static bool enabled();
+
+    // Keeps the pool enabled while it is alive, e.g. while the results of a command that asked for it exist
+    class Scope
+    {
+        public:
+            Scope();
+            ~Scope();
+
+            Scope(const Scope&) = delete;
+            Scope& operator=(const Scope&) = delete;
+    };
+
+    static void* allocate(std::size_t bytes);
+    static void deallocate(void* buffer, std::size_t bytes) noexcept;
+
+    // Counted in debug builds only (POOL_STATISTICS), zero otherwise
+    static Statistics statistics();
+};
+
+template <typename T>
+struct Pool_allocator
+{
+    using value_type = T;
+
+    Pool_allocator() noexcept = default;
+
+    template <typename U>
+    Pool_allocator(const Pool_allocator<U>&) noexcept
+    {}
+
+    T*
+    allocate(std::size_t n)
+    {
+        return static_cast<T*>(Buffer_pool::allocate(n * sizeof(T)));
+    }
+
+    void
+    deallocate(T* buffer, std::size_t n) noexcept
+    {
+        Buffer_pool::deallocate(buffer, n * sizeof(T));
+    }
+};
+
+// All buffers come from the same pools, any allocator frees what any other allocated
+template <typename T, typename U>
+bool
+operator==(const Pool_allocator<T>&, const Pool_allocator<U>&) noexcept
+{
+    return true;
+}
+
+template <typename T, typename U>
+bool
+operator!=(const Pool_allocator<T>&, const Pool_allocator<U>&) noexcept
+{
+    return false;
+}
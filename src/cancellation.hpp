@@ -0,0 +1,72 @@
+#pragma once
+
+/*
+ *  This file is part of Lime, a tool for the application of Likhtman & McLiesh' model for polymer dyanmics.
+ *
+ *  Copyright © 2020 Daniel Emmery (CNRS)
+ *
+ *  File contents:
+ *
+ *  Cooperative cancellation of long running calculations
+ *
+ *  GPL 3.0 License
+ *
+ */
+
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+
+struct Cancelled : public std::runtime_error
+{
+    Cancelled()
+    :   std::runtime_error("Calculation cancelled.")
+    {}
+};
+
+// Cancelled on request or once a deadline passes. Calculations poll it at checkpoints, so it can be shared between threads.
+class Cancellation_token
+{
+    public:
+        using clock = std::chrono::steady_clock;
+
+        Cancellation_token()
+        :   cancelled_{false}, deadline_{clock::time_point::max()}
+        {}
+
+        // Deadline relative to now, in seconds
+        explicit Cancellation_token(double budget)
+        :   cancelled_{false},
+            deadline_{clock::now() + std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(budget))}
+        {}
+
+        void
+        cancel()
+        {
+            cancelled_.store(true);
+        }
+
+        bool
+        cancelled() const
+        {
+            if (not cancelled_.load() and clock::now() >= deadline_)
+            {
+                cancelled_.store(true);
+            }
+
+            return cancelled_.load();
+        }
+
+        void
+        throw_if_cancelled() const
+        {
+            if (cancelled())
+            {
+                throw Cancelled();
+            }
+        }
+
+    private:
+        mutable std::atomic<bool> cancelled_;
+        const clock::time_point deadline_;
+};
@@ -0,0 +1,187 @@
+/*
+ *  This file is part of Lime, a tool for the application of Likhtman & McLiesh' model for polymer dyanmics.
+ *
+ *  Copyright © 2020 Daniel Emmery (CNRS)
+ *
+ *  File contents:
+ *
+ *  Checkpoints of running fits, from which an interrupted fit can be resumed
+ *
+ *  GPL 3.0 License
+ *
+ */
+
+#include "checkpoint.hpp"
+
+#include <fstream>
+#include <iomanip>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+
+namespace
+{
+    // Write a copy and move it in place, so an interrupted write leaves the previous file intact
+    template <typename Write>
+    void
+    replace_file(const std::filesystem::path& path, std::ios::openmode mode, Write write)
+    {
+        auto temporary = path;
+        temporary += ".tmp";
+
+        {
+            std::ofstream file(temporary, mode);
+
+            if (not file)
+            {
+                throw std::runtime_error("Could not write " + temporary.string());
+            }
+
+            write(file);
+        }
+
+        std::filesystem::rename(temporary, path);
+    }
+}
+
+void
+Fit_checkpoint::save(const std::filesystem::path& path) const
+{
+    replace_file(path, std::ios::out, [this](std::ofstream& file) {
+        file << std::setprecision(std::numeric_limits<double>::max_digits10);
+        file << "# lime fit checkpoint\n";
+        file << "fingerprint " << fingerprint << '\n';
+        file << "iterations " << iterations << '\n';
+        file << "cost " << cost << '\n';
+        file << "parameters " << parameters.size();
+
+        for (const double parameter : parameters)
+        {
+            file << ' ' << parameter;
+        }
+
+        file << '\n';
+
+        if (not spectrum.empty())
+        {
+            file << "spectrum " << spectrum.string() << '\n';
+        }
+    });
+}
+
+Fit_checkpoint
+Fit_checkpoint::load(const std::filesystem::path& path)
+{
+    std::ifstream file(path);
+
+    if (not file)
+    {
+        throw std::runtime_error("Could not open checkpoint " + path.string());
+    }
+
+    Fit_checkpoint checkpoint{};
+    bool has_parameters{false};
+    std::string line;
+
+    while (std::getline(file, line))
+    {
+        if (line.empty() or line.front() == '#')
+        {
+            continue;
+        }
+
+        std::istringstream stream(line);
+        std::string key;
+        stream >> key;
+
+        if (key == "fingerprint")
+        {
+            stream >> checkpoint.fingerprint;
+        }
+        else if (key == "iterations")
+        {
+            stream >> checkpoint.iterations;
+        }
+        else if (key == "cost")
+        {
+            stream >> checkpoint.cost;
+        }
+        else if (key == "parameters")
+        {
+            size_t count;
+            stream >> count;
+            checkpoint.parameters.resize(count);
+
+            for (auto& parameter : checkpoint.parameters)
+            {
+                stream >> parameter;
+            }
+
+            has_parameters = true;
+        }
+        else if (key == "spectrum")
+        {
+            // Paths may hold spaces
+            std::getline(stream >> std::ws, line);
+            checkpoint.spectrum = line;
+        }
+
+        if (stream.fail())
+        {
+            throw std::runtime_error("Unreadable line in checkpoint " + path.string() + ": " + line);
+        }
+    }
+
+    if (not has_parameters)
+    {
+        throw std::runtime_error("Checkpoint " + path.string() + " holds no parameters.");
+    }
+
+    return checkpoint;
+}
+
+void
+Spectrum::save(const std::filesystem::path& path) const
+{
+    replace_file(path, std::ios::out | std::ios::binary, [this](std::ofstream& file) {
+        const size_t count = values.size();
+
+        file.write(reinterpret_cast<const char*>(&seed), sizeof(seed));
+        file.write(reinterpret_cast<const char*>(&realization_size), sizeof(realization_size));
+        file.write(reinterpret_cast<const char*>(&count), sizeof(count));
+        file.write(reinterpret_cast<const char*>(values.data()), static_cast<std::streamsize>(count * sizeof(double)));
+    });
+}
+
+Spectrum
+Spectrum::load(const std::filesystem::path& path)
+{
+    std::ifstream file(path, std::ios::binary);
+
+    if (not file)
+    {
+        throw std::runtime_error("Could not open spectrum " + path.string());
+    }
+
+    Spectrum spectrum{};
+    size_t count;
+
+    file.read(reinterpret_cast<char*>(&spectrum.seed), sizeof(spectrum.seed));
+    file.read(reinterpret_cast<char*>(&spectrum.realization_size), sizeof(spectrum.realization_size));
+    file.read(reinterpret_cast<char*>(&count), sizeof(count));
+
+    if (not file or spectrum.realization_size == 0 or count % spectrum.realization_size != 0)
+    {
+        throw std::runtime_error("Unreadable spectrum " + path.string());
+    }
+
+    spectrum.values.resize(count);
+    file.read(reinterpret_cast<char*>(spectrum.values.data()), static_cast<std::streamsize>(count * sizeof(double)));
+
+    if (not file)
+    {
+        throw std::runtime_error("Spectrum " + path.string() + " is truncated.");
+    }
+
+    return spectrum;
+}
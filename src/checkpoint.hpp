@@ -0,0 +1,45 @@
+#pragma once
+
+/*
+ *  This file is part of Lime, a tool for the application of Likhtman & McLiesh' model for polymer dyanmics.
+ *
+ *  Copyright © 2020 Daniel Emmery (CNRS)
+ *
+ *  File contents:
+ *
+ *  Checkpoints of running fits, from which an interrupted fit can be resumed
+ *
+ *  GPL 3.0 License
+ *
+ */
+
+#include <filesystem>
+#include <string>
+#include <vector>
+
+// Small plain text file, written every few iterations of a fit
+struct Fit_checkpoint
+{
+    // Of the input file and the selected column, see Warm_start_key
+    std::string fingerprint;
+    size_t iterations;
+    double cost;
+    // External values of the free variables
+    std::vector<double> parameters;
+    // Rubinstein & Colby only: file holding the random spectrum the fit runs with, empty otherwise
+    std::filesystem::path spectrum;
+
+    void save(const std::filesystem::path& path) const;
+    static Fit_checkpoint load(const std::filesystem::path& path);
+};
+
+// Random spectrum of Rubinstein & Colby's constraint release, stored binary as it holds Z times the number of realizations values
+struct Spectrum
+{
+    unsigned int seed;
+    size_t realization_size;
+    std::vector<double> values;
+
+    void save(const std::filesystem::path& path) const;
+    static Spectrum load(const std::filesystem::path& path);
+};
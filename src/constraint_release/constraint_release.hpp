@@ -34,6 +34,19 @@ struct IConstraint_release : public Time_functor, public Compute
     
     virtual void update(const Context& ctx) = 0;
     virtual void validate_update(const Context& ctx) const = 0;
+
+    // Only implementations with kernels in both precisions switch, others keep computing in double
+    virtual void set_precision(Precision) {}
+
+    // Independent work items within one time point, 0 if a point can't be split. With few time points, the
+    // autotuner spreads these over the threads instead, in chunks of the given size, 0 evaluates them in sequence.
+    // The chunk only changes how values are computed, not the values, so it is set on const evaluations too.
+    virtual size_t inner_work() const { return 0; }
+    virtual void set_inner_chunk(size_t) const {}
+    // Times the inner work was split so far. A point may split it several times, like once per quadrature node,
+    // so the autotuner weighs the cost of splitting against one of these instead of a whole point.
+    virtual size_t inner_regions() const { return 0; }
+
     double c_v_;
 };
 
@@ -46,6 +59,31 @@ namespace constraint_release
         DOUBLEREPTATION
     };
 
+    inline const char* name(impl implementation)
+    {
+        switch (implementation)
+        {
+            case HEUZEY:          return "Heuzey";
+            case RUBINSTEINCOLBY: return "Rubinstein & Colby";
+            case DOUBLEREPTATION: return "double reptation";
+        }
+
+        return "unknown";
+    }
+
+    // Name of the ICS model with this constraint release in the autotuner's profile
+    inline const char* kernel_name(impl implementation)
+    {
+        switch (implementation)
+        {
+            case HEUZEY:          return "ics_heuzey";
+            case RUBINSTEINCOLBY: return "ics_rubinsteincolby";
+            case DOUBLEREPTATION: return "ics_doublereptation";
+        }
+
+        return "ics";
+    }
+
     typedef Factory_template<IConstraint_release, impl, double, Context&> Factory_observed;
     typedef Factory_template<IConstraint_release, impl, double, double, double, double, double> Factory;
 }
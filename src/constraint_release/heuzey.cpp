@@ -16,6 +16,8 @@
 
 #include "heuzey.hpp"
 #include "../parallel_policy.hpp"
+#include "../autotune.hpp"
+#include "../error_channel.hpp"
 #include "../lime_log_utils.hpp"
 
 #include <algorithm>
@@ -37,12 +39,12 @@ Time_series HEU_constraint_release::operator()(const Time_series::time_type& tim
 {
     Time_series res{time_range};
     
-    std::transform(exec_policy, time_range->begin(), time_range->end(), res.begin(), std::ref(*this));
+    Error_channel errors;
 
-    if (Async_except::get()->ep)
-    {
-        std::rethrow_exception(Async_except::get()->ep);
-    }
+    static const Kernel_id kernel{"heuzey"};
+    tuned_transform(kernel, time_range->begin(), time_range->end(), res.begin(), errors.guard(std::cref(*this)));
+
+    errors.rethrow_if_failed();
 
     return res;
 }
@@ -82,52 +84,42 @@ HEU_constraint_release::validate_update(const Context& ctx) const
 }
 
 // TODO: should really create a predicated factory for this
-HEU_constraint_release::Model_ptr
+HEU_constraint_release::Model
 HEU_constraint_release::get_model(double Z, double tau_e, double tau_df)
 {
-    Model_ptr ptr;
-
     // Select model appropriate for chain length
     if (Z <= 10.0)
     {
-        ptr = std::make_unique<Short>(Z, tau_e, tau_df);
+        return Short(Z, tau_e, tau_df);
     }
     else if (Z > 10.0 and Z <= 160.0)
     {
-        ptr = std::make_unique<Medium>(Z, tau_e, tau_df);
+        return Medium(Z, tau_e, tau_df);
     }
     else if (Z > 160.0 and Z <= 360.0)
     {
-        ptr = std::make_unique<Long>(Z, tau_e, tau_df);
+        return Long(Z, tau_e, tau_df);
     }
     else
     {
-        ptr = std::make_unique<Extra_long>(Z, tau_e, tau_df);
+        return Extra_long(Z, tau_e, tau_df);
     }
-
-    return ptr;
 }
 
 double
 HEU_constraint_release::integral_result(double lower_bound, double t) const
 {         
-    auto f = [this, t] (double epsilon) -> double {
-        return (*model_)(epsilon)*std::exp(-epsilon*c_v_*t);
-    };
+    const IModel& model = std::visit([](const auto& alternative) -> const IModel& { return alternative; }, model_);
 
-    double res{0.0};
+    auto f = [this, &model, t] (double epsilon) -> double {
+        return model(epsilon)*std::exp(-epsilon*c_v_*t);
+    };
 
-    try
-    {
-        using namespace boost::math::quadrature;
-        exp_sinh<double> integrator;
-        double termination = std::sqrt(std::numeric_limits<double>::epsilon());
-        res = integrator.integrate(f, lower_bound, std::numeric_limits<double>::infinity(), termination, nullptr, nullptr, nullptr);
-    }
-    catch (const std::exception& ex)
-    {
-        Async_except::get()->ep = std::current_exception();
-    }
+    using namespace boost::math::quadrature;
+    // Its abscissas and weights are computed once and shared by all threads
+    static exp_sinh<double> integrator;
+    double termination = std::sqrt(std::numeric_limits<double>::epsilon());
+    const double res = integrator.integrate(f, lower_bound, std::numeric_limits<double>::infinity(), termination, nullptr, nullptr, nullptr);
 
     return res;
 }
@@ -34,9 +34,9 @@ struct IModel
     virtual double operator() (double epsilon) const = 0;
 
   protected:
-    const double Z;
-    const double tau_e;
-    const double tau_df;
+    double Z;
+    double tau_e;
+    double tau_df;
 
     double B1;
     double B2;
@@ -92,7 +92,8 @@ struct Extra_long : public Long
 
 struct HEU_constraint_release : public IConstraint_release
 {
-    using Model_ptr = std::unique_ptr<heuzey_detail::IModel>;
+    // Held by value, updates of the context swap models without allocating
+    using Model = std::variant<heuzey_detail::Short, heuzey_detail::Medium, heuzey_detail::Long, heuzey_detail::Extra_long>;
 
   public:
     HEU_constraint_release(double c_v, Context& ctx);
@@ -108,10 +109,10 @@ struct HEU_constraint_release : public IConstraint_release
     // Equation 20, select lower bound for integration
     double epsilon_zero(double Z, double tau_e) const;
     double integral_result(double lower_bound, double t) const;
-    Model_ptr get_model(double Z, double tau_e, double tau_df);
+    Model get_model(double Z, double tau_e, double tau_df);
     void validate_update(const Context& ctx) const override;
 
-    Model_ptr model_;
+    Model model_;
     double epsilon_zero_;
     double tau_e_;
 };
\ No newline at end of file
@@ -15,9 +15,12 @@
 #include <boost/math/quadrature/exp_sinh.hpp>
 #include <boost/math/tools/roots.hpp>
 #include <boost/hana.hpp>
+#include <boost/iterator/counting_iterator.hpp>
 
 #include "../utilities.hpp"
 #include "../parallel_policy.hpp"
+#include "../autotune.hpp"
+#include "../error_channel.hpp"
 #include "../lime_log_utils.hpp"
 #include "../checks.hpp"
 
@@ -36,7 +39,7 @@ RUB_constraint_release::RUB_constraint_release(double c_v, Context& ctx)
 }
 
 RUB_constraint_release::RUB_constraint_release(double c_v, double Z, double tau_e, double G_f_normed, double tau_df)
-: IConstraint_release{c_v}, prng{std::random_device{}()}, dist(0, 1)
+: IConstraint_release{c_v}, precision_{Precision::DOUBLE}, inner_chunk_{0}, inner_regions_{0}, seed_{std::random_device{}()}, prng{seed_}, dist(0, 1)
 {
     const double E_star = e_star(Z, tau_e, G_f_normed);
 
@@ -44,16 +47,26 @@ RUB_constraint_release::RUB_constraint_release(double c_v, double Z, double tau_
     generate(G_f_normed, tau_df, tau_e, E_star, Z);
 }
 
+RUB_constraint_release::RUB_constraint_release(double c_v, const RUB_constraint_release& source)
+: IConstraint_release{c_v}, realizations_{source.realizations_}, realization_size_{source.realization_size_}, km{source.km},
+  precision_{source.precision_}, km_single_{source.km_single_}, inner_chunk_{0}, inner_regions_{0}, seed_{source.seed_}, prng{seed_}, dist(0, 1)
+{
+    #if defined CUDA && defined CUDA_FOUND
+    cudetails.set_km(*km);
+    #endif
+}
+
 Time_series RUB_constraint_release::operator()(const Time_series::time_type& time_range) const
 {
     Time_series res{time_range};
 
-    std::transform(exec_policy, time_range->begin(), time_range->end(), res.begin(), std::ref(*this));
+    Error_channel errors;
 
-    if (Async_except::get()->ep)
-    {
-        std::rethrow_exception(Async_except::get()->ep);
-    }
+    static const Kernel_id kernel{"rubinsteincolby"};
+    tuned_transform(kernel, time_range->begin(), time_range->end(), res.begin(), errors.guard(std::cref(*this)),
+                    inner_work(), [this](size_t chunk) { set_inner_chunk(chunk); }, [this]() { return inner_regions(); });
+
+    errors.rethrow_if_failed();
 
     return res;
 }
@@ -93,13 +106,96 @@ RUB_constraint_release::update(const Context& ctx)
     generate(ctx.G_f_normed, ctx.tau_df, ctx.tau_e, E_star, ctx.Z);
 }
 
+unsigned int
+RUB_constraint_release::get_seed() const
+{
+    return seed_;
+}
+
+size_t
+RUB_constraint_release::get_realization_size() const
+{
+    return realization_size_;
+}
+
+RUB_constraint_release::Spectrum_ptr
+RUB_constraint_release::get_spectrum() const
+{
+    return km;
+}
+
+void
+RUB_constraint_release::set_spectrum(unsigned int seed, size_t realization_size, Spectrum_ptr spectrum)
+{
+    if (not spectrum or realization_size < 2 or spectrum->size() % realization_size != 0)
+    {
+        throw std::runtime_error("Spectrum does not hold a whole number of realizations.");
+    }
+
+    seed_ = seed;
+    realization_size_ = realization_size;
+    realizations_ = spectrum->size() / realization_size;
+    km = std::move(spectrum);
+
+    sync_single_precision();
+
+    #if defined CUDA && defined CUDA_FOUND
+    cudetails.set_km(*km);
+    #endif
+}
+
 void
+RUB_constraint_release::set_precision(Precision precision)
+{
+    // Keeps a single precision copy shared with the source of the spectrum
+    if (precision == precision_)
+    {
+        return;
+    }
+
+    precision_ = precision;
+
+    sync_single_precision();
+}
+
+size_t
+RUB_constraint_release::inner_work() const
+{
+    return realizations_;
+}
+
+void
+RUB_constraint_release::set_inner_chunk(size_t chunk) const
+{
+    inner_chunk_.store(chunk);
+}
+
+size_t
+RUB_constraint_release::inner_regions() const
+{
+    return inner_regions_.load(std::memory_order_relaxed);
+}
+
+void
+RUB_constraint_release::sync_single_precision()
+{
+    if (precision_ == Precision::SINGLE)
+    {
+        km_single_ = std::make_shared<const std::vector<float>>(km->begin(), km->end());
+    }
+    else
+    {
+        km_single_.reset();
+    }
+}
+
+size_t
 RUB_constraint_release::set_sizing_requirements(size_t Z)
 {
     realization_size_ = Z;
     realizations_ = (Z > 100 ? Z*3 : 600);
 
-    km.resize(Z * realizations_);
+    return Z * realizations_;
 }
 
 double
@@ -113,11 +209,12 @@ RUB_constraint_release::e_star(double Z, double tau_e, double G_f_normed)
 void
 RUB_constraint_release::generate(double G_f_normed, double tau_df, double tau_e, double e_star, double Z)
 {
-    set_sizing_requirements(static_cast<size_t>(Z));
+    // Instances sharing the previous spectrum keep it
+    auto spectrum = std::make_shared<std::vector<double>>(set_sizing_requirements(static_cast<size_t>(Z)));
 
     double p_star = std::sqrt(Z/10.0);
 
-    std::generate(km.begin(), km.end(), [this] (){ return dist(prng); });
+    std::generate(spectrum->begin(), spectrum->end(), [this] (){ return dist(prng); });
 
     // minimize function depending on the random input
     auto minimize_functor = [&] (double& rand_) {
@@ -140,10 +237,17 @@ RUB_constraint_release::generate(double G_f_normed, double tau_df, double tau_e,
         rand_ = (r.first + (r.second - r.first) / 2.0);
     };
 
-    std::for_each(exec_policy, km.begin(), km.end(), minimize_functor);
+    // minimize_functor catches the bisection's exceptions
+    with_sync_policy(spectrum->size(), [&](const auto& policy) {
+        std::for_each(policy, spectrum->begin(), spectrum->end(), minimize_functor);
+    });
+
+    km = std::move(spectrum);
+
+    sync_single_precision();
 
     #if defined CUDA && defined CUDA_FOUND
-    cudetails.set_km(km);
+    cudetails.set_km(*km);
     #endif
 }
 
@@ -156,27 +260,64 @@ RUB_constraint_release::Me(double epsilon) const
 #else
 double
 RUB_constraint_release::Me(double&& epsilon) const
+{
+    if (precision_ == Precision::SINGLE)
+    {
+        return Me_kernel<float>(*km_single_, static_cast<float>(epsilon));
+    }
+
+    return Me_kernel<double>(*km, epsilon);
+}
+
+template <typename T>
+double
+RUB_constraint_release::Me_kernel(const std::vector<T>& spectrum, T epsilon) const
+{
+    const size_t chunk = inner_chunk_.load(std::memory_order_relaxed);
+    size_t number_of_negative_values;
+
+    inner_regions_.fetch_add(1, std::memory_order_relaxed);
+
+    if (chunk == 0)
+    {
+        number_of_negative_values = negative_values(spectrum, epsilon, 0, realizations_);
+    }
+    else
+    {
+        const boost::counting_iterator<size_t> first(0), last((realizations_ + chunk - 1) / chunk);
+
+        number_of_negative_values = std::transform_reduce(exec_policy, first, last, size_t{0}, std::plus<>(), [&](size_t c) {
+            return negative_values(spectrum, epsilon, c * chunk, std::min(realizations_, (c + 1) * chunk));
+        });
+    }
+
+    return static_cast<double>(number_of_negative_values) / static_cast<double>(spectrum.size());
+}
+
+template <typename T>
+size_t
+RUB_constraint_release::negative_values(const std::vector<T>& spectrum, T epsilon, size_t first, size_t last) const
 {
     size_t number_of_negative_values{0};
-    double s{0};
+    T s{0};
 
-    for (size_t j = 0 ; j < realizations_ ; ++j)
+    for (size_t j = first ; j < last ; ++j)
     {
         const size_t stride = j * realization_size_;
 
-        s = km[0+stride] + km[1+stride] - epsilon;
+        s = spectrum[0+stride] + spectrum[1+stride] - epsilon;
         if (s < 0.0)
             ++number_of_negative_values;
 
         for (size_t i = 1+stride; i < stride+realization_size_-1 ; ++i)
         {
-            s = km[i] + km[i+1] - epsilon - square(km[i])/s;
+            s = spectrum[i] + spectrum[i+1] - epsilon - square(spectrum[i])/s;
             if (s < 0.0)
                 ++number_of_negative_values;
         }
     }
 
-    return static_cast<double>(number_of_negative_values) / static_cast<double>(km.size());
+    return number_of_negative_values;
 }
 #endif
 
@@ -188,19 +329,11 @@ RUB_constraint_release::integral_result(double t) const
         return Me(std::forward<double>(epsilon)) * exp(-epsilon*c_v_*t);
     };
 
-    double res{0.0};
-
-    try
-    {
-        using namespace boost::math::quadrature;
-        exp_sinh<double> integrator;
-        double termination = std::sqrt(std::numeric_limits<double>::epsilon());
-        res = c_v_ * t * integrator.integrate(f, 0, std::numeric_limits<double>::infinity(), termination, nullptr, nullptr, nullptr);
-    }
-    catch (const std::exception& ex)
-    {
-        Async_except::get()->ep = std::current_exception();
-    }
+    using namespace boost::math::quadrature;
+    // Its abscissas and weights are computed once and shared by all threads
+    static exp_sinh<double> integrator;
+    double termination = std::sqrt(std::numeric_limits<double>::epsilon());
+    const double res = c_v_ * t * integrator.integrate(f, 0, std::numeric_limits<double>::infinity(), termination, nullptr, nullptr, nullptr);
 
     return res;
 }
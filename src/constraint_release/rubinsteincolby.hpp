@@ -21,6 +21,8 @@
   #include "rubinsteincolby_cu.hpp"
 #endif
 
+#include <atomic>
+#include <memory>
 #include <random>
 #include <stdexcept>
 
@@ -29,20 +31,47 @@ struct RUB_constraint_release : public IConstraint_release
   public:
     RUB_constraint_release(double c_v, Context& ctx);
     RUB_constraint_release(double c_v, double Z, double tau_e, double G_f_normed, double tau_df);
+    // Shares the spectrum of source instead of drawing one, for results evaluated concurrently with it
+    RUB_constraint_release(double c_v, const RUB_constraint_release& source);
     void update(const Context& ctx) override;
     Time_series operator()(const Time_series::time_type&) const override;
     Time_series::value_primitive operator()(const Time_series::time_primitive&) const override;
 
+    // The spectrum is random, these allow continuing a fit with the realization it started with.
+    // It is immutable, a new draw replaces it, so several instances can hold the same one.
+    using Spectrum_ptr = std::shared_ptr<const std::vector<double>>;
+
+    unsigned int get_seed() const;
+    size_t get_realization_size() const;
+    Spectrum_ptr get_spectrum() const;
+    void set_spectrum(unsigned int seed, size_t realization_size, Spectrum_ptr spectrum);
+
+    // Single precision evaluates Me on a float copy of the spectrum, the double spectrum stays the reference
+    void set_precision(Precision precision) override;
+
+    // Realizations of the spectrum
+    size_t inner_work() const override;
+    void set_inner_chunk(size_t chunk) const override;
+    // Calls of Me
+    size_t inner_regions() const override;
+
   private:
     double cp(double G_f_normed, double tau_df, double tau_e, double p_star, double e_star, double epsilon, double e_start);
     void generate(double G_f_normed, double tau_df, double tau_e, double e_star, double Z);
     double cp_one(double G_f_normed, double tau_df, double p_star, double epsilon);
     double cp_two(double Z, double tau_e, double e_star, double epsilon);
     double e_star(double Z, double tau_e, double G_f_normed);
-    void set_sizing_requirements(size_t Z);
+    // Number of values of the spectrum
+    size_t set_sizing_requirements(size_t Z);
     void validate_update(const Context& ctx) const override;
 
     double Me(double&& epsilon) const;
+    template <typename T>
+    double Me_kernel(const std::vector<T>& spectrum, T epsilon) const;
+    // Over realizations [first, last)
+    template <typename T>
+    size_t negative_values(const std::vector<T>& spectrum, T epsilon, size_t first, size_t last) const;
+    void sync_single_precision();
     double integral_result(double t) const;
 
     size_t realizations_;
@@ -52,8 +81,12 @@ struct RUB_constraint_release : public IConstraint_release
     Cu_me_details cudetails;
     #endif
 
-    std::vector<double> km;
-    const std::seed_seq seed;
+    Spectrum_ptr km;
+    Precision precision_;
+    std::shared_ptr<const std::vector<float>> km_single_;
+    mutable std::atomic<size_t> inner_chunk_;
+    mutable std::atomic<size_t> inner_regions_;
+    unsigned int seed_;
     std::mt19937  prng;
     std::uniform_real_distribution<double> dist;
 };
\ No newline at end of file
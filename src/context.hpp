@@ -88,6 +88,15 @@ struct Compute
 BOOST_HANA_ADAPT_STRUCT(Context,
     M, N, N_e, M_e, Z, a, b, G_e, G_f_normed, tau_e, tau_d_0, tau_r, tau_df, tau_monomer);
 
+// Copies the parameters only, physics and computes stay with their context
+inline void
+copy_parameters(const Context& from, Context& to)
+{
+    boost::hana::for_each(boost::hana::keys(from), [&from, &to](auto key) {
+        boost::hana::at_key(to, key) = boost::hana::at_key(from, key);
+    });
+}
+
 class IContext_view
 {
 public:
@@ -13,6 +13,8 @@
 
 #include "contour_length_fluctuations.hpp"
 #include "parallel_policy.hpp"
+#include "autotune.hpp"
+#include "error_channel.hpp"
 #include "lime_log_utils.hpp"
 
 #include <boost/math/quadrature/exp_sinh.hpp>
@@ -36,12 +38,12 @@ Time_series Contour_length_fluctuations::operator()(const Time_series::time_type
 {
     Time_series res{time_range};
 
-    std::transform(exec_policy, time_range->begin(), time_range->end(), res.begin(), *this);
+    Error_channel errors;
 
-    if (Async_except::get()->ep)
-    {
-        std::rethrow_exception(Async_except::get()->ep);
-    }
+    static const Kernel_id kernel{"clf"};
+    tuned_transform(kernel, time_range->begin(), time_range->end(), res.begin(), errors.guard(std::cref(*this)));
+
+    errors.rethrow_if_failed();
 
     return res;
 }
@@ -115,19 +117,11 @@ Contour_length_fluctuations::integral_result(double lower_bound, double t)
         return std::exp(res);
     };
 
-    double res{0.0};
-
-    try
-    {
-        using namespace boost::math::quadrature;
-        exp_sinh<double> integrator;
-        double termination = std::sqrt(std::numeric_limits<double>::epsilon());
-        res = integrator.integrate(f, lower_bound , std::numeric_limits<double>::infinity(), termination, nullptr, nullptr, nullptr);
-    }
-    catch (const std::exception&)
-    {
-        Async_except::get()->ep = std::current_exception();
-    }
+    using namespace boost::math::quadrature;
+    // Its abscissas and weights are computed once and shared by all threads
+    static exp_sinh<double> integrator;
+    double termination = std::sqrt(std::numeric_limits<double>::epsilon());
+    const double res = integrator.integrate(f, lower_bound , std::numeric_limits<double>::infinity(), termination, nullptr, nullptr, nullptr);
 
     return res;
 }
@@ -38,12 +38,13 @@ struct Contour_length_fluctuations : public Time_functor, Compute
     // Calcualte new values for mu_t;
     void update(const Context& ctx) override;
 
-  private:
-    static double integral_result(double lower_bound, double t);
     // Lower bound for integration
     static double e_star(double Z, double tau_e, double G_f_normed);  
+    static double norm(double Z, double tau_e);
+
+  private:
+    static double integral_result(double lower_bound, double t);
     sum_t sum_term(double Z, double tau_df);
-    double norm(double Z, double tau_e);
     void validate_update(const Context& ctx) const override;
 
     double G_f_normed_;
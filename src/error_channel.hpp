@@ -0,0 +1,95 @@
+#pragma once
+
+/*
+ *  This file is part of Lime, a tool for the application of Likhtman & McLiesh' model for polymer dyanmics.
+ *
+ *  Copyright © 2020 Daniel Emmery (CNRS)
+ *
+ *  File contents:
+ *
+ *  Propagation of errors out of parallel algorithms
+ *
+ *  GPL 3.0 License
+ *
+ */
+
+#include <atomic>
+#include <exception>
+#include <type_traits>
+#include <utility>
+
+// Exceptions can't leave a parallel algorithm. Each invocation of one gets its own channel, which keeps the first
+// exception thrown by an element, lets the remaining elements return right away, and rethrows on the calling thread
+// once the algorithm returned. The first error is claimed with an atomic, no lock is taken. Guarded functions
+// catch exceptions and use that atomic, so they run with sync_exec_policy (see with_sync_policy), not par_unseq.
+class Error_channel
+{
+    public:
+        Error_channel()
+        :   state_{empty}
+        {}
+
+        Error_channel(const Error_channel&) = delete;
+        Error_channel& operator=(const Error_channel&) = delete;
+
+        bool
+        failed() const noexcept
+        {
+            return state_.load(std::memory_order_relaxed) != empty;
+        }
+
+        // Only the first error is kept, the others are dropped
+        void
+        capture(std::exception_ptr error) noexcept
+        {
+            int expected = empty;
+
+            if (state_.compare_exchange_strong(expected, writing, std::memory_order_acquire, std::memory_order_relaxed))
+            {
+                error_ = std::move(error);
+                state_.store(ready, std::memory_order_release);
+            }
+        }
+
+        // Call after the algorithm returned
+        void
+        rethrow_if_failed() const
+        {
+            if (state_.load(std::memory_order_acquire) == ready)
+            {
+                std::rethrow_exception(error_);
+            }
+        }
+
+        // func, with its exceptions captured by this channel. Once an error was captured, the remaining calls
+        // are skipped and return a value initialized result.
+        template <typename F>
+        auto
+        guard(F func)
+        {
+            return [this, func](auto&&... args) {
+                using result_t = std::invoke_result_t<const F&, decltype(args)...>;
+
+                if (failed())
+                {
+                    return result_t();
+                }
+
+                try
+                {
+                    return func(std::forward<decltype(args)>(args)...);
+                }
+                catch (...)
+                {
+                    capture(std::current_exception());
+                    return result_t();
+                }
+            };
+        }
+
+    private:
+        enum : int { empty, writing, ready };
+
+        std::atomic<int> state_;
+        std::exception_ptr error_;
+};
@@ -15,6 +15,7 @@
 
 #include <memory>
 #include <map>
+#include <vector>
 #include <functional>
 #include <stdexcept>
 
@@ -48,6 +49,16 @@ public:
          return (iter->second)(args...);
    }
 
+   static std::vector<Key_type> keys()
+   {
+      std::vector<Key_type> registered;
+
+      for (const auto& entry : get_function_map())
+         registered.push_back(entry.first);
+
+      return registered;
+   }
+
 private:
    Factory_template() = default;
 
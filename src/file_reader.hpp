@@ -32,7 +32,8 @@ struct File_reader
 
         auto file_contents = parse_file<ics_file_format, clear_comments, store_headers>(inpath);
 
-        values = Get<Time_series::value_primitive>::col(value_col, file_contents.out);
+        const auto column = Get<Time_series::value_primitive>::col(value_col, file_contents.out);
+        values.assign(column.begin(), column.end());
         time = Time_range::convert(Get<double>::col(time_col, file_contents.out));
 
         file_contents.buffer.clear();
@@ -14,8 +14,15 @@
  */
 
 #include <tuple>
+#include <array>
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <memory>
 #include <functional>
 #include <sstream>
+#include <string>
+#include <limits>
 #include <any>
 
 #include <gsl/gsl_matrix.h>
@@ -26,15 +33,60 @@
 #include "lime_log_utils.hpp"
 #include "time_series.hpp"
 #include "result.hpp"
+#include "parameter_transform.hpp"
+#include "fit_common.hpp"
+#include "cancellation.hpp"
+#include "utilities.hpp"
+
+// Trust region configuration of the nonlinear least squares solver
+struct Strategy
+{
+	std::string name;
+	const gsl_multifit_nlinear_trs* trs;
+	const gsl_multifit_nlinear_scale* scale;
+	const gsl_multifit_nlinear_solver* solver;
+};
+
+inline std::vector<Strategy>
+default_strategies()
+{
+	return {
+		{"subspace2D", gsl_multifit_nlinear_trs_subspace2D, gsl_multifit_nlinear_scale_more, gsl_multifit_nlinear_solver_svd},
+		{"lmaccel", gsl_multifit_nlinear_trs_lmaccel, gsl_multifit_nlinear_scale_more, gsl_multifit_nlinear_solver_qr},
+		{"dogleg", gsl_multifit_nlinear_trs_dogleg, gsl_multifit_nlinear_scale_more, gsl_multifit_nlinear_solver_qr},
+		{"ddogleg", gsl_multifit_nlinear_trs_ddogleg, gsl_multifit_nlinear_scale_more, gsl_multifit_nlinear_solver_qr}
+	};
+}
 
 template <typename... T>
 struct Fit
 {
+	using Transform_ptr = std::shared_ptr<const IParameter_transform>;
+	using Transforms = std::array<Transform_ptr, sizeof...(T)>;
+
+	// Lowest cost evaluation so far, returned when the fit is cancelled
+	struct Best
+	{
+		double cost;
+		std::array<double, sizeof...(T)> parameters;
+		double linear_scale;
+		Time_series::value_type values;
+	};
+
 	struct User_data
   	{
 		const Time_series::value_type* fitting_data_points;
 		std::tuple<T&...>* free_variables; 
+		const Transforms* transforms;
 		ICS_result* result;
+		const double* weights;
+		// Only used for variable projection
+		double* linear_scale;
+		// Only used for geodesic acceleration
+		const gsl_multifit_nlinear_workspace* workspace;
+		gsl_vector* x_step;
+		gsl_vector* f_step;
+		Best* best;
 	};
 
 	using Target_func = int(*)(const gsl_vector*, void*, gsl_vector*);
@@ -46,6 +98,29 @@ struct Fit
 	std::tuple<T&...> free_variables;
 	void (*callback_func)(const size_t, void*, const gsl_multifit_nlinear_workspace *w);
 	void* callback_params;
+	double* linear_scale;
+	// GSL works on the unconstrained internal values, the context gets the transformed (external) values
+	Transforms transforms;
+	// Standard errors of the free variables, available after fitting
+	std::array<double, sizeof...(T)> standard_errors;
+	size_t max_iterations;
+	// Checked after every iteration with the iteration count and the cost, returning true ends the fit early
+	std::function<bool(size_t, double)> stop;
+	// Sum of squared weighted residuals, iteration count and whether stop ended the fit, available after fitting
+	double cost;
+	size_t iterations;
+	bool stopped;
+	// If set, the model evaluation polls it and the fit returns the best parameters found once it is cancelled,
+	// rather than throwing when it fails to converge
+	std::shared_ptr<const Cancellation_token> cancellation;
+	double initial_cost;
+	bool cancelled;
+	bool converged;
+	// Called every checkpoint_interval iterations with the iteration count, the external parameters and the cost
+	std::function<void(size_t, const std::array<double, sizeof...(T)>&, double)> checkpoint;
+	size_t checkpoint_interval;
+	// Iterations done before the fit was resumed, they count towards max_iterations
+	size_t resumed_iterations;
 
 	Fit(T&... free_variables_)
 	: workspace{nullptr},
@@ -54,8 +129,25 @@ struct Fit
 	  algorithm{gsl_multifit_nlinear_trust},
 	  free_variables{free_variables_...},
 	  callback_func{&default_callback},
-	  callback_params{nullptr}
+	  callback_params{nullptr},
+	  linear_scale{nullptr},
+	  transforms{},
+	  standard_errors{},
+	  max_iterations{100},
+	  stop{},
+	  cost{0.0},
+	  iterations{0},
+	  stopped{false},
+	  cancellation{},
+	  initial_cost{0.0},
+	  cancelled{false},
+	  converged{false},
+	  checkpoint{},
+	  checkpoint_interval{1},
+	  resumed_iterations{0}
 	{
+		transforms.fill(std::make_shared<Identity_transform>());
+
 		fdf_params.scale = gsl_multifit_nlinear_scale_more;
 		fdf_params.trs =   gsl_multifit_nlinear_trs_subspace2D;
 		fdf_params.fdtype = GSL_MULTIFIT_NLINEAR_CTRDIFF;
@@ -64,22 +156,66 @@ struct Fit
 		fdf_params.factor_down = 2;
 	}
 
+	// Levenberg-Marquardt with geodesic acceleration, see Transtrum & Sethna (arXiv:1201.5885)
+	void
+	use_geodesic_acceleration()
+	{
+		fdf_params.trs = gsl_multifit_nlinear_trs_lmaccel;
+	}
+
+	bool
+	uses_geodesic_acceleration() const
+	{
+		return fdf_params.trs == gsl_multifit_nlinear_trs_lmaccel;
+	}
+
+	void
+	use_strategy(const Strategy& strategy)
+	{
+		fdf_params.trs = strategy.trs;
+		fdf_params.scale = strategy.scale;
+		fdf_params.solver = strategy.solver;
+	}
+
+	void
+	set_transform(size_t index, Transform_ptr transform)
+	{
+		transforms.at(index) = transform;
+	}
+
+	// Keeps all free variables positive
+	void
+	use_log_transform()
+	{
+		transforms.fill(std::make_shared<Log_transform>());
+	}
+
+	// Variable projection: the model is linear in scale (e.g. G_e when decoupled), so instead of
+	// making it a free variable we solve its optimal value in closed form at every evaluation.
+	// Only valid if no physics in the context overwrites scale.
+	void
+	eliminate_linear_scale(double& scale)
+	{
+		linear_scale = &scale;
+	}
+
  	static void
 	default_callback(const size_t iter, void *, const gsl_multifit_nlinear_workspace *w)
 	{
 		gsl_vector *f = gsl_multifit_nlinear_residual(w);
 		gsl_vector *x = gsl_multifit_nlinear_position(w);
 
+		const User_data* userdata = static_cast<const User_data*>(w->fdf->params);
+
 		std::stringstream out;
 
-		out << "iter " << iter;
+		out << fit_detail::iteration_message(iter, x, *userdata->transforms);
 		
-		for (size_t i = 0 ; i < sizeof...(T) ; ++i)
+		if (userdata->linear_scale)
 		{
-			out << ", " << i << ": ";
-			out << gsl_vector_get(x, i);
+			out << ", linear: " << *userdata->linear_scale;
 		}
-		
+
 		out << ", |f(x)| = " << gsl_blas_dnrm2(f);
 
 		BOOST_LOG_TRIVIAL(info) << out.str();
@@ -88,26 +224,262 @@ struct Fit
 	static
     int
     fit_func (const gsl_vector* x, void* data, gsl_vector* f) {
-      	User_data userdata = *static_cast<User_data*>(data);
+      	User_data& userdata = *static_cast<User_data*>(data);
 
-  		std::apply([&x](auto&... elems){
-			size_t i{0};
-			((elems = gsl_vector_get (x, i), ++i), ...);
-    	}, *userdata.free_variables);
+		fit_detail::to_external(x, *userdata.transforms, *userdata.free_variables);
+
+		if (userdata.linear_scale)
+		{
+			*userdata.linear_scale = 1.0;
+		}
+
+		try
+		{
+			userdata.result->context_->apply_physics();
+    		userdata.result->calculate();
+		}
+		catch (const Cancelled&)
+		{
+			return GSL_EFAILED;
+		}
+
+		if (userdata.linear_scale)
+		{
+			solve_linear_scale(userdata);
+		}
 
-		userdata.result->context_->apply_physics();
-    	userdata.result->calculate();
+		const auto res = userdata.result->values();
 
-		auto res = userdata.result->get_values();
+		double chisq{0.0};
 
     	for (size_t j = 0; j < userdata.fitting_data_points->size(); j++)
     	{
-    	    gsl_vector_set (f, j, ((*userdata.fitting_data_points)[j] -  res[j]) / (*userdata.fitting_data_points)[j]);
+			const double residual = ((*userdata.fitting_data_points)[j] -  res[j]) / (*userdata.fitting_data_points)[j];
+    	    gsl_vector_set (f, j, residual);
+			chisq += userdata.weights[j] * residual * residual;
     	}
 
+		if (userdata.best and chisq < userdata.best->cost)
+		{
+			keep_best(userdata, chisq);
+		}
+
     	return GSL_SUCCESS;
     };
 
+	static
+	void
+	keep_best(const User_data& userdata, double chisq)
+	{
+		Best& best = *userdata.best;
+
+		best.cost = chisq;
+
+		std::apply([&best](const auto&... elems){
+			size_t i{0};
+			((best.parameters[i++] = elems), ...);
+		}, *userdata.free_variables);
+
+		if (userdata.linear_scale)
+		{
+			best.linear_scale = *userdata.linear_scale;
+		}
+
+		best.values.assign(userdata.result->cbegin(), userdata.result->cend());
+	}
+
+	// Moves the context and result back to the best evaluation
+	void
+	restore_best(const Best& best, ICS_result& driver)
+	{
+		std::apply([&best](auto&... elems){
+			size_t i{0};
+			((elems = best.parameters[i++]), ...);
+		}, free_variables);
+
+		if (linear_scale)
+		{
+			*linear_scale = best.linear_scale;
+		}
+
+		driver.context_->apply_physics();
+
+		std::copy(best.values.begin(), best.values.end(), driver.begin());
+	}
+
+	// With unit scale the model gives g_j, and the residuals are r_j = 1 - s*g_j/y_j.
+	// Minimizing sum_j w_j r_j^2 over s gives s = sum_j w_j a_j / sum_j w_j a_j^2, with a_j = g_j/y_j
+	static
+	void
+	solve_linear_scale(User_data& userdata)
+	{
+		const auto& data_points = *userdata.fitting_data_points;
+
+		double numerator{0.0};
+		double denominator{0.0};
+
+		auto unscaled = userdata.result->cbegin();
+
+		for (size_t j = 0; j < data_points.size(); ++j, ++unscaled)
+		{
+			const double a = *unscaled / data_points[j];
+			numerator += userdata.weights[j] * a;
+			denominator += userdata.weights[j] * a * a;
+		}
+
+		if (denominator <= 0.0)
+		{
+			BOOST_LOG_TRIVIAL(warning) << "Could not solve linear scale, model is zero for all data points.";
+			return;
+		}
+
+		const double scale = numerator / denominator;
+
+		*userdata.linear_scale = scale;
+
+		with_policy(data_points.size(), [&](const auto& policy) {
+			std::transform(policy, userdata.result->begin(), userdata.result->end(), userdata.result->begin(), [scale](double value){return scale * value;});
+		});
+	}
+
+	// Second directional derivative of the residuals along v, using a one-sided finite difference.
+	// The residual and Jacobian at x are already held by the workspace, so this costs a single model evaluation.
+	// fvv = 2/h * ( (f(x+hv) - f(x))/h - J v )
+	static
+	int
+	fit_fvv (const gsl_vector* x, const gsl_vector* v, void* data, gsl_vector* fvv)
+	{
+		User_data& userdata = *static_cast<User_data*>(data);
+		const gsl_multifit_nlinear_workspace* w = userdata.workspace;
+		const double h = w->params.h_fvv;
+
+		for (size_t i = 0 ; i < sizeof...(T) ; ++i)
+		{
+			gsl_vector_set(userdata.x_step, i, gsl_vector_get(x, i) + h*gsl_vector_get(v, i));
+		}
+
+		int status = fit_func(userdata.x_step, data, userdata.f_step);
+
+		if (status != GSL_SUCCESS)
+		{
+			return status;
+		}
+
+		// fvv <- J v
+		gsl_blas_dgemv(CblasNoTrans, 1.0, w->J, v, 0.0, fvv);
+
+		// The cached residual and Jacobian are weighted, while GSL expects an unweighted fvv
+		for (size_t j = 0 ; j < fvv->size ; ++j)
+		{
+			const double sqrt_wt = gsl_vector_get(w->sqrt_wts, j);
+			const double f_x = gsl_vector_get(w->f, j) / sqrt_wt;
+			const double jv = gsl_vector_get(fvv, j) / sqrt_wt;
+
+			gsl_vector_set(fvv, j, 2.0/h * ((gsl_vector_get(userdata.f_step, j) - f_x)/h - jv));
+		}
+
+		return GSL_SUCCESS;
+	}
+
+	// Covariance of the external parameters from the Jacobian in internal parameters
+	void
+	external_covariance(const gsl_matrix* J, const gsl_vector* x, gsl_matrix* covar) const
+	{
+		gsl_multifit_nlinear_covar(J, 0.0, covar);
+		to_external_covariance(transforms, x, covar);
+	}
+
+	// Same iteration as gsl_multifit_nlinear_driver, with a check of the stop predicate after every iteration
+	int
+	iterate(const double xtol, const double gtol, const double ftol, int* info)
+	{
+		int status;
+
+		iterations = resumed_iterations;
+		stopped = false;
+		cancelled = false;
+
+		do
+		{
+			status = gsl_multifit_nlinear_iterate(workspace);
+
+			if (cancellation and cancellation->cancelled())
+			{
+				cancelled = true;
+				return GSL_EFAILED;
+			}
+
+			// No step reduced the cost, further iterations won't help
+			if (status == GSL_ENOPROG and iterations == resumed_iterations)
+			{
+				*info = status;
+				return GSL_EMAXITER;
+			}
+
+			++iterations;
+
+			if (callback_func)
+			{
+				callback_func(iterations, callback_params, workspace);
+			}
+
+			if (checkpoint and iterations % checkpoint_interval == 0)
+			{
+				write_checkpoint();
+			}
+
+			status = gsl_multifit_nlinear_test(xtol, gtol, ftol, info, workspace);
+
+			if (status == GSL_CONTINUE and stop)
+			{
+				double chisq;
+				const gsl_vector* f = gsl_multifit_nlinear_residual(workspace);
+				gsl_blas_ddot(f, f, &chisq);
+
+				stopped = stop(iterations, chisq);
+			}
+		}
+		while (status == GSL_CONTINUE and not stopped and iterations < max_iterations);
+
+		if (stopped)
+		{
+			return GSL_CONTINUE;
+		}
+
+		// Converged to within machine precision
+		if (status == GSL_ETOLF or status == GSL_ETOLX or status == GSL_ETOLG)
+		{
+			*info = status;
+			status = GSL_SUCCESS;
+		}
+
+		if (iterations >= max_iterations and status != GSL_SUCCESS)
+		{
+			status = GSL_EMAXITER;
+		}
+
+		return status;
+	}
+
+	void
+	write_checkpoint() const
+	{
+		const gsl_vector* x = gsl_multifit_nlinear_position(workspace);
+		const gsl_vector* f = gsl_multifit_nlinear_residual(workspace);
+
+		std::array<double, sizeof...(T)> parameters;
+
+		for (size_t i = 0 ; i < sizeof...(T) ; ++i)
+		{
+			parameters[i] = transforms[i]->to_external(gsl_vector_get(x, i));
+		}
+
+		double chisq;
+		gsl_blas_ddot(f, f, &chisq);
+
+		checkpoint(iterations, parameters, chisq);
+	}
+
 	int
 	fit(const Time_series::value_type& fitting_data, ICS_result& driver, double wt_pow = 1.2)
 	{
@@ -117,29 +489,37 @@ struct Fit
 		size_t n = fitting_data.size();
 
 		double x_init[sizeof...(T)];
-		double weights[n];
+		// Heap backed, large data sets would overflow the stack
+		std::vector<double> weights = fit_detail::data_weights(fitting_data, wt_pow);
 
 		User_data userdata
 		{
 			&fitting_data,
 			&free_variables,
-			&driver
+			&transforms,
+			&driver,
+			weights.data(),
+			linear_scale,
+			nullptr,
+			nullptr,
+			nullptr,
+			nullptr
 		};
 
-		std::apply([&x_init](auto&&... elems){
-			size_t i{0};
-			((x_init[i] = std::forward<decltype(elems)>(elems), ++i), ...);
-    	}, std::forward<std::tuple<T&...>>(free_variables));
-
-		gsl_vector_view x = gsl_vector_view_array(x_init, sizeof...(T));
+		Best best{std::numeric_limits<double>::infinity(), {}, 1.0, {}};
 
-		for (size_t i = 0 ; i < n ; ++i)
+		if (cancellation)
 		{
-			double wt = fitting_data[i];
-			weights[i] = std::pow(wt, wt_pow);
+			userdata.best = &best;
 		}
 
-		gsl_vector_view wts = gsl_vector_view_array(weights, n);
+		fit_detail::to_internal(free_variables, transforms, x_init);
+
+		const double initial_linear_scale = linear_scale ? *linear_scale : 1.0;
+
+		gsl_vector_view x = gsl_vector_view_array(x_init, sizeof...(T));
+
+		gsl_vector_view wts = gsl_vector_view_array(weights.data(), n);
 
 		double chisq, chisq0;
 		int status, info;
@@ -151,35 +531,124 @@ struct Fit
 		/* define the function to be minimized */
    	    function.f = &fit_func;
 		function.df = nullptr;
-		function.fvv = nullptr; // Voor geodesic aanzetten
+		function.fvv = uses_geodesic_acceleration() ? &fit_fvv : nullptr;
 		function.n = n;
 		function.p = sizeof...(T);
 		function.params = &userdata;
 
-		/* allocate workspace with default parameters */
-		workspace = gsl_multifit_nlinear_alloc(algorithm, &fdf_params, n, sizeof...(T));
+		/* allocate workspace with default parameters, owned so evaluations that throw don't leak it */
+		std::unique_ptr<gsl_multifit_nlinear_workspace, decltype(&gsl_multifit_nlinear_free)> workspace_owner{
+			gsl_multifit_nlinear_alloc(algorithm, &fdf_params, n, sizeof...(T)), &gsl_multifit_nlinear_free};
 
-		if (workspace == nullptr)
+		if (workspace_owner == nullptr)
 		{
 			throw std::runtime_error("Could not allocate fitting solver: likely out of memory.");
 		}
 
-		/* initialize solver with starting point and weights */
-		gsl_multifit_nlinear_winit(&x.vector, &wts.vector, &function, workspace);
+		workspace = workspace_owner.get();
+		Scope_guard forget_workspace{[this]() { workspace = nullptr; }};
 
-		/* compute initial cost function */
-		f = gsl_multifit_nlinear_residual(workspace);
-		gsl_blas_ddot(f, f, &chisq0);
+		std::unique_ptr<gsl_vector, decltype(&gsl_vector_free)> x_step{nullptr, &gsl_vector_free};
+		std::unique_ptr<gsl_vector, decltype(&gsl_vector_free)> f_step{nullptr, &gsl_vector_free};
 
-		status = gsl_multifit_nlinear_driver(100, xtol, gtol, ftol, callback_func, callback_params, &info, workspace);
+		if (uses_geodesic_acceleration())
+		{
+			x_step.reset(gsl_vector_alloc(sizeof...(T)));
+			f_step.reset(gsl_vector_alloc(n));
+
+			userdata.workspace = workspace;
+			userdata.x_step = x_step.get();
+			userdata.f_step = f_step.get();
+		}
+
+		// The result polls the token while the solver runs, and gets its own back however the solver exits
+		{
+			const auto previous_cancellation = driver.cancellation;
+			driver.cancellation = cancellation;
+			Scope_guard restore_cancellation{[&driver, &previous_cancellation]() { driver.cancellation = previous_cancellation; }};
+
+			/* initialize solver with starting point and weights */
+			status = gsl_multifit_nlinear_winit(&x.vector, &wts.vector, &function, workspace);
+
+			/* compute initial cost function */
+			f = gsl_multifit_nlinear_residual(workspace);
+			gsl_blas_ddot(f, f, &chisq0);
+			initial_cost = chisq0;
+
+			if (status == GSL_SUCCESS)
+			{
+				status = iterate(xtol, gtol, ftol, &info);
+			}
+			else
+			{
+				cancelled = cancellation and cancellation->cancelled();
+				iterations = resumed_iterations;
+			}
+		}
+
+		// Cancelled before a single evaluation finished. Evaluating the initial guess now would ignore the budget,
+		// so the parameters stay at the initial guess, without a cost, and the result isn't evaluated.
+		if (cancelled and not std::isfinite(best.cost))
+		{
+			fit_detail::to_external(&x.vector, transforms, free_variables);
+
+			if (linear_scale)
+			{
+				*linear_scale = initial_linear_scale;
+			}
+
+			driver.context_->apply_physics();
+
+			cost = std::numeric_limits<double>::infinity();
+			converged = false;
+			standard_errors.fill(std::numeric_limits<double>::quiet_NaN());
+
+			BOOST_LOG_TRIVIAL(warning) << "Fit cancelled before its first evaluation, keeping the initial guess.";
+
+			return 0;
+		}
 
 		/* compute final cost */
 	  	gsl_blas_ddot(f, f, &chisq);
-		gsl_multifit_nlinear_free(workspace);
+		cost = chisq;
+
+		// The workspace may hold a partial evaluation, fall back to the best evaluation seen
+		const bool use_best = cancellation and (cancelled or status == GSL_EMAXITER or status == GSL_ENOPROG);
+
+		converged = not use_best and not stopped and status == GSL_SUCCESS;
+
+		if (use_best)
+		{
+			restore_best(best, driver);
+			cost = best.cost;
+			standard_errors.fill(std::numeric_limits<double>::quiet_NaN());
+		}
+		/* parameter uncertainties, scaled by the goodness of fit */
+		else if (n > sizeof...(T))
+		{
+			gsl_matrix* covar = gsl_matrix_alloc(sizeof...(T), sizeof...(T));
+			external_covariance(gsl_multifit_nlinear_jac(workspace), gsl_multifit_nlinear_position(workspace), covar);
+			fit_detail::scaled_standard_errors(covar, chisq, n, standard_errors);
+			gsl_matrix_free(covar);
+		}
 
-		if (status == GSL_SUCCESS)
+		if (use_best)
+		{
+			BOOST_LOG_TRIVIAL(warning) << (cancelled ? "Fit cancelled" : "Fit did not converge") << " after " << iterations
+				<< " iterations, returning the best parameters found: cost " << cost << " (initial " << initial_cost << ").";
+		}
+		else if (stopped)
+		{
+			BOOST_LOG_TRIVIAL(info) << "Fit stopped after " << iterations << " iterations.";
+		}
+		else if (status == GSL_SUCCESS)
 		{
 			BOOST_LOG_TRIVIAL(info) << "Fit converged.";
+
+			for (size_t i = 0 ; i < sizeof...(T) ; ++i)
+			{
+				BOOST_LOG_TRIVIAL(info) << "Standard error " << i << ": " << standard_errors[i];
+			}
 		}
 		else if (status == GSL_EMAXITER)
 		{
@@ -191,4 +660,65 @@ struct Fit
 		}
 		return 0;
 	}
-};
\ No newline at end of file
+};
+
+// Coarse to fine fitting: the fit first runs on a log decimated subset of the data and every following level
+// multiplies the density by level_factor, warm started from the previous one. The final level uses all data.
+// Coarse levels that fail to converge only log a warning, their parameters are still a better guess.
+template <typename Driver>
+int
+fit_multilevel(Driver& fit_driver, const Time_series::value_type& fitting_data, ICS_result& result, double wt_pow,
+	size_t points_per_decade = 10, size_t level_factor = 4)
+{
+	const auto full_range = result.get_time_range();
+
+	if (level_factor < 2)
+	{
+		throw std::runtime_error("Multilevel fitting requires a level factor of at least 2.");
+	}
+
+	for (size_t density = points_per_decade ; ; density *= level_factor)
+	{
+		const auto indices = Time_range::log_decimate(*full_range, density);
+
+		// Not much to gain anymore, leave the rest to the full data
+		if (2 * indices.size() > full_range->size())
+		{
+			break;
+		}
+
+		if (indices.size() <= fit_driver.transforms.size())
+		{
+			continue;
+		}
+
+		Time_range::base level_range(indices.size());
+		Time_series::value_type level_data(indices.size());
+
+		for (size_t i = 0 ; i < indices.size() ; ++i)
+		{
+			level_range[i] = (*full_range)[indices[i]];
+			level_data[i] = fitting_data[indices[i]];
+		}
+
+		BOOST_LOG_TRIVIAL(info) << "Fitting level with " << density << " points per decade (" << indices.size() << " of " << full_range->size() << " points).";
+
+		result.set_time_range(Time_range::convert(level_range));
+
+		// Whatever the level throws, the caller's result goes back to the full grid
+		Scope_guard restore_range{[&result, &full_range]() { result.set_time_range(full_range); }};
+
+		try
+		{
+			fit_driver.fit(level_data, result, wt_pow);
+		}
+		catch (const std::runtime_error& e)
+		{
+			BOOST_LOG_TRIVIAL(warning) << "Coarse level did not converge, continuing: " << e.what();
+		}
+	}
+
+	BOOST_LOG_TRIVIAL(info) << "Fitting full data (" << full_range->size() << " points).";
+
+	return fit_driver.fit(fitting_data, result, wt_pow);
+}
@@ -0,0 +1,187 @@
+#pragma once
+
+/*
+ *  This file is part of Lime, a tool for the application of Likhtman & McLiesh' model for polymer dyanmics.
+ *
+ *  Copyright © 2020 Daniel Emmery (CNRS)
+ *
+ *  File contents:
+ *
+ *  Bootstrap estimates of the uncertainty of fitted parameters
+ *
+ *  GPL 3.0 License
+ *
+ */
+
+#include <array>
+#include <vector>
+#include <algorithm>
+#include <numeric>
+#include <random>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+#include "lime_log_utils.hpp"
+#include "parallel_policy.hpp"
+#include "time_series.hpp"
+#include "fit_multistart.hpp"
+
+enum class Resampling
+{
+    // Draw every residual independently
+    RESIDUALS,
+    // Draw runs of consecutive residuals, which keeps correlations between neighbouring time points
+    BLOCKS
+};
+
+struct Percentile_interval
+{
+    double lower;
+    double median;
+    double upper;
+};
+
+// The fit weighs relative residuals, and G(t) spans decades, so residuals are resampled as ratios data/model:
+// a replicate is the model times ratios drawn from the fitted data. A block size of zero picks n^(1/3).
+template <typename Generator>
+Time_series::value_type
+resample(const Time_series::value_type& data, const Time_series::value_type& model, Resampling resampling, size_t block_size, Generator& generator)
+{
+    const size_t n = data.size();
+
+    if (model.size() != n or n == 0)
+    {
+        throw std::runtime_error("Bootstrap requires a model value for every data point.");
+    }
+
+    std::vector<double> ratios(n);
+    std::transform(data.begin(), data.end(), model.begin(), ratios.begin(), [](double d, double m) {
+        return m != 0.0 ? d / m : 1.0;
+    });
+
+    Time_series::value_type resampled(n);
+
+    if (resampling == Resampling::BLOCKS)
+    {
+        if (block_size == 0)
+        {
+            block_size = static_cast<size_t>(std::ceil(std::cbrt(static_cast<double>(n))));
+        }
+
+        block_size = std::min(block_size, n);
+
+        std::uniform_int_distribution<size_t> start(0, n - block_size);
+
+        for (size_t i = 0 ; i < n ; )
+        {
+            const size_t first = start(generator);
+
+            for (size_t j = 0 ; j < block_size and i < n ; ++j, ++i)
+            {
+                resampled[i] = model[i] * ratios[first + j];
+            }
+        }
+    }
+    else
+    {
+        std::uniform_int_distribution<size_t> index(0, n - 1);
+
+        for (size_t i = 0 ; i < n ; ++i)
+        {
+            resampled[i] = model[i] * ratios[index(generator)];
+        }
+    }
+
+    return resampled;
+}
+
+// Percentiles by linear interpolation between the order statistics, the interval is centred and holds confidence of the values
+inline Percentile_interval
+percentile_interval(std::vector<double> values, double confidence)
+{
+    if (values.empty())
+    {
+        throw std::runtime_error("No values to compute percentiles of.");
+    }
+
+    std::sort(values.begin(), values.end());
+
+    auto percentile = [&values](double q) {
+        const double position = q * static_cast<double>(values.size() - 1);
+        const size_t below = static_cast<size_t>(std::floor(position));
+        const size_t above = std::min(below + 1, values.size() - 1);
+        return values[below] + (position - static_cast<double>(below)) * (values[above] - values[below]);
+    };
+
+    const double tail = (1.0 - confidence) / 2.0;
+
+    return Percentile_interval{percentile(tail), percentile(0.5), percentile(1.0 - tail)};
+}
+
+// Resamples data around the fitted model replicates times, and runs fit_replicate(resampled) for all of them on the
+// thread pool. Every replicate draws its data set in its own task, from a generator seeded with (seed, replicate), so
+// only the data sets in flight are held and the replicates don't depend on the scheduling.
+// Replicates that fail are returned with an infinite cost.
+template <size_t P, typename Fit_replicate>
+std::vector<Start_result<P>>
+run_bootstrap(const Time_series::value_type& data, const Time_series::value_type& model, size_t replicates, Resampling resampling,
+    size_t block_size, Fit_replicate fit_replicate, unsigned int seed = 0)
+{
+    std::vector<Start_result<P>> results(replicates);
+    std::vector<size_t> indices(replicates);
+    std::iota(indices.begin(), indices.end(), 0);
+
+    with_task_policy([&](const auto& policy) {
+        std::for_each(policy, indices.begin(), indices.end(), [&](size_t i) {
+            // Exceptions can't leave a parallel algorithm
+            try
+            {
+                std::seed_seq replicate_seed{seed, static_cast<unsigned int>(i)};
+                std::mt19937 generator(replicate_seed);
+
+                results[i] = fit_replicate(resample(data, model, resampling, block_size, generator));
+            }
+            catch (const std::exception& e)
+            {
+                BOOST_LOG_TRIVIAL(warning) << "Bootstrap replicate " << i << " failed: " << e.what();
+                results[i].cost = std::numeric_limits<double>::infinity();
+            }
+        });
+    });
+
+    return results;
+}
+
+// Replicates that failed, or were cancelled by a time budget and hold the parameters they started at, don't count
+template <size_t P>
+bool
+replicate_finished(const Start_result<P>& result)
+{
+    return result.converged and std::isfinite(result.cost);
+}
+
+// Percentile intervals of every parameter over the replicates that finished
+template <size_t P>
+std::array<Percentile_interval, P>
+bootstrap_intervals(const std::vector<Start_result<P>>& results, double confidence)
+{
+    std::array<Percentile_interval, P> intervals;
+
+    for (size_t i = 0 ; i < P ; ++i)
+    {
+        std::vector<double> values;
+
+        for (const auto& result : results)
+        {
+            if (replicate_finished(result))
+            {
+                values.push_back(result.solution[i]);
+            }
+        }
+
+        intervals[i] = percentile_interval(values, confidence);
+    }
+
+    return intervals;
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+/*
+ *  This file is part of Lime, a tool for the application of Likhtman & McLiesh' model for polymer dyanmics.
+ *
+ *  Copyright © 2020 Daniel Emmery (CNRS)
+ *
+ *  File contents:
+ *
+ *  Pieces shared by the dense (Fit) and the large data (Large_fit) nonlinear least squares fits
+ *
+ *  GPL 3.0 License
+ *
+ */
+
+#include <tuple>
+#include <array>
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <sstream>
+#include <string>
+
+#include <gsl/gsl_matrix.h>
+#include <gsl/gsl_vector.h>
+
+#include "parallel_policy.hpp"
+#include "time_series.hpp"
+#include "parameter_transform.hpp"
+
+namespace fit_detail
+{
+
+template <size_t N>
+using Transforms = std::array<std::shared_ptr<const IParameter_transform>, N>;
+
+// Moves the free variables to the external values of the internal parameters x
+template <size_t N, typename... T>
+void
+to_external(const gsl_vector* x, const Transforms<N>& transforms, std::tuple<T&...>& free_variables)
+{
+	std::apply([&x, &transforms](auto&... elems){
+		size_t i{0};
+		((elems = transforms[i]->to_external(gsl_vector_get(x, i)), ++i), ...);
+	}, free_variables);
+}
+
+// Internal values of the free variables, the starting point of the solver
+template <size_t N, typename... T>
+void
+to_internal(const std::tuple<T&...>& free_variables, const Transforms<N>& transforms, double* x)
+{
+	std::apply([&x, &transforms](const auto&... elems){
+		size_t i{0};
+		((x[i] = transforms[i]->to_internal(elems), ++i), ...);
+	}, free_variables);
+}
+
+// w_j = y_j^power
+inline std::vector<double>
+data_weights(const Time_series::value_type& data, double power)
+{
+	std::vector<double> weights(data.size());
+
+	with_policy(data.size(), [&](const auto& policy) {
+		std::transform(policy, data.begin(), data.end(), weights.begin(),
+			[power](double y){ return std::pow(y, power); });
+	});
+
+	return weights;
+}
+
+// "iter i, 0: x_0, 1: x_1, ..." in external values, completed by the caller
+template <size_t N>
+std::string
+iteration_message(size_t iter, const gsl_vector* x, const Transforms<N>& transforms)
+{
+	std::stringstream out;
+
+	out << "iter " << iter;
+
+	for (size_t i = 0 ; i < N ; ++i)
+	{
+		out << ", " << i << ": " << transforms[i]->to_external(gsl_vector_get(x, i));
+	}
+
+	return out.str();
+}
+
+// Standard errors from the external covariance, scaled by the goodness of fit when it is worse than the weights imply
+template <size_t N>
+void
+scaled_standard_errors(const gsl_matrix* covar, double chisq, size_t n, std::array<double, N>& standard_errors)
+{
+	const double c = std::max(1.0, std::sqrt(chisq / static_cast<double>(n - N)));
+
+	for (size_t i = 0 ; i < N ; ++i)
+	{
+		standard_errors[i] = c * std::sqrt(gsl_matrix_get(covar, i, i));
+	}
+}
+
+}
@@ -0,0 +1,296 @@
+#pragma once
+
+/*
+ *  This file is part of Lime, a tool for the application of Likhtman & McLiesh' model for polymer dyanmics.
+ *
+ *  Copyright © 2020 Daniel Emmery (CNRS)
+ *
+ *  File contents:
+ *
+ *  Fit free variables shared by several data sets, e.g. a series of chain lengths of the same polymer
+ *
+ *  GPL 3.0 License
+ *
+ */
+
+#include <array>
+#include <vector>
+#include <algorithm>
+#include <numeric>
+#include <atomic>
+#include <memory>
+#include <functional>
+#include <sstream>
+#include <string>
+#include <stdexcept>
+
+#include <gsl/gsl_errno.h>
+#include <gsl/gsl_matrix.h>
+#include <gsl/gsl_vector.h>
+#include <gsl/gsl_blas.h>
+#include <gsl/gsl_multifit_nlinear.h>
+
+#include "lime_log_utils.hpp"
+#include "parallel_policy.hpp"
+#include "time_series.hpp"
+#include "result.hpp"
+#include "parameter_transform.hpp"
+#include "fit_common.hpp"
+
+// Every data set is evaluated on its own result, concurrently, and the weighted residuals of all data sets are
+// stacked into a single least squares problem. The free variables are shared: assign writes them into the context
+// of every data set, which holds everything else that differs between data sets, like N.
+template <size_t P>
+struct Joint_fit
+{
+	using Parameters = std::array<double, P>;
+	using Assign = std::function<void(const Parameters&, Context&)>;
+	using Transform_ptr = std::shared_ptr<const IParameter_transform>;
+	using Transforms = fit_detail::Transforms<P>;
+
+	struct Dataset
+	{
+		const Time_series::value_type* data;
+		ICS_result* result;
+	};
+
+	struct User_data
+	{
+		const std::vector<Dataset>* datasets;
+		// Index of the first residual of every data set
+		const std::vector<size_t>* offsets;
+		// 0, 1, ... over the data sets, to spread them over threads
+		const std::vector<size_t>* indices;
+		const Transforms* transforms;
+		const Assign* assign;
+	};
+
+	gsl_multifit_nlinear_parameters fdf_params;
+	Assign assign;
+	Transforms transforms;
+	void (*callback_func)(const size_t, void*, const gsl_multifit_nlinear_workspace *w);
+	size_t max_iterations;
+	// Standard errors of the free variables and sum of squared weighted residuals, available after fitting
+	Parameters standard_errors;
+	double cost;
+	bool converged;
+
+	explicit Joint_fit(Assign assign_)
+	: fdf_params{gsl_multifit_nlinear_default_parameters()},
+	  assign{assign_},
+	  transforms{},
+	  callback_func{&default_callback},
+	  max_iterations{100},
+	  standard_errors{},
+	  cost{0.0},
+	  converged{false}
+	{
+		transforms.fill(std::make_shared<Identity_transform>());
+
+		fdf_params.scale = gsl_multifit_nlinear_scale_more;
+		fdf_params.trs =   gsl_multifit_nlinear_trs_subspace2D;
+		fdf_params.fdtype = GSL_MULTIFIT_NLINEAR_CTRDIFF;
+		fdf_params.solver = gsl_multifit_nlinear_solver_svd;
+		fdf_params.factor_up = 3;
+		fdf_params.factor_down = 2;
+	}
+
+	void
+	set_transform(size_t index, Transform_ptr transform)
+	{
+		transforms.at(index) = transform;
+	}
+
+	static void
+	default_callback(const size_t iter, void *, const gsl_multifit_nlinear_workspace *w)
+	{
+		gsl_vector *f = gsl_multifit_nlinear_residual(w);
+		gsl_vector *x = gsl_multifit_nlinear_position(w);
+
+		const User_data* userdata = static_cast<const User_data*>(w->fdf->params);
+
+		std::stringstream out;
+
+		out << fit_detail::iteration_message(iter, x, *userdata->transforms);
+		out << ", |f(x)| = " << gsl_blas_dnrm2(f);
+
+		BOOST_LOG_TRIVIAL(info) << out.str();
+	}
+
+	static
+	Parameters
+	external(const gsl_vector* x, const Transforms& transforms)
+	{
+		Parameters parameters;
+
+		for (size_t i = 0 ; i < P ; ++i)
+		{
+			parameters[i] = transforms[i]->to_external(gsl_vector_get(x, i));
+		}
+
+		return parameters;
+	}
+
+	static
+	int
+	joint_func(const gsl_vector* x, void* data, gsl_vector* f)
+	{
+		const User_data& userdata = *static_cast<User_data*>(data);
+		const auto& datasets = *userdata.datasets;
+
+		const Parameters parameters = external(x, *userdata.transforms);
+
+		std::atomic<bool> failed{false};
+
+		with_task_policy([&](const auto& policy) {
+			std::for_each(policy, userdata.indices->begin(), userdata.indices->end(), [&](size_t d) {
+				const auto& fitting_data = *datasets[d].data;
+				ICS_result& result = *datasets[d].result;
+
+				// Exceptions can't leave a parallel algorithm
+				try
+				{
+					(*userdata.assign)(parameters, *result.context_);
+					result.context_->apply_physics();
+					result.calculate();
+				}
+				catch (const std::exception& e)
+				{
+					BOOST_LOG_TRIVIAL(warning) << "Evaluation of data set " << d << " failed: " << e.what();
+					failed.store(true);
+					return;
+				}
+
+				auto value = result.cbegin();
+				const size_t offset = (*userdata.offsets)[d];
+
+				for (size_t j = 0 ; j < fitting_data.size() ; ++j, ++value)
+				{
+					gsl_vector_set(f, offset + j, (fitting_data[j] - *value) / fitting_data[j]);
+				}
+			});
+		});
+
+		return failed.load() ? GSL_EFAILED : GSL_SUCCESS;
+	}
+
+	// parameters holds the initial guess, and the solution afterwards
+	int
+	fit(const std::vector<Dataset>& datasets, Parameters& parameters, double wt_pow = 1.2)
+	{
+		if (datasets.empty())
+		{
+			throw std::runtime_error("A joint fit needs at least one data set.");
+		}
+
+		std::vector<size_t> offsets(datasets.size());
+		size_t n{0};
+
+		for (size_t d = 0 ; d < datasets.size() ; ++d)
+		{
+			offsets[d] = n;
+			n += datasets[d].data->size();
+		}
+
+		std::vector<double> weights(n);
+
+		for (size_t d = 0 ; d < datasets.size() ; ++d)
+		{
+			const std::vector<double> dataset_weights = fit_detail::data_weights(*datasets[d].data, wt_pow);
+			std::copy(dataset_weights.begin(), dataset_weights.end(), weights.begin() + offsets[d]);
+		}
+
+		std::vector<size_t> indices(datasets.size());
+		std::iota(indices.begin(), indices.end(), 0);
+
+		User_data userdata{&datasets, &offsets, &indices, &transforms, &assign};
+
+		double x_init[P];
+
+		for (size_t i = 0 ; i < P ; ++i)
+		{
+			x_init[i] = transforms[i]->to_internal(parameters[i]);
+		}
+
+		gsl_vector_view x = gsl_vector_view_array(x_init, P);
+		gsl_vector_view wts = gsl_vector_view_array(weights.data(), n);
+
+		gsl_multifit_nlinear_fdf function;
+		function.f = &joint_func;
+		function.df = nullptr;
+		function.fvv = nullptr;
+		function.n = n;
+		function.p = P;
+		function.params = &userdata;
+
+		// Owned so evaluations that throw don't leak it
+		std::unique_ptr<gsl_multifit_nlinear_workspace, decltype(&gsl_multifit_nlinear_free)> workspace_owner{
+			gsl_multifit_nlinear_alloc(gsl_multifit_nlinear_trust, &fdf_params, n, P), &gsl_multifit_nlinear_free};
+
+		if (workspace_owner == nullptr)
+		{
+			throw std::runtime_error("Could not allocate fitting solver: likely out of memory.");
+		}
+
+		gsl_multifit_nlinear_workspace* workspace = workspace_owner.get();
+
+		const double xtol = 1e-14;
+		const double gtol = 1e-14;
+		const double ftol = 1e-14;
+
+		int info;
+
+		int status = gsl_multifit_nlinear_winit(&x.vector, &wts.vector, &function, workspace);
+
+		if (status == GSL_SUCCESS)
+		{
+			status = gsl_multifit_nlinear_driver(max_iterations, xtol, gtol, ftol, callback_func, nullptr, &info, workspace);
+		}
+
+		const gsl_vector* position = gsl_multifit_nlinear_position(workspace);
+
+		parameters = external(position, transforms);
+
+		// The last evaluation may have been a finite difference step, move all results to the solution
+		gsl_vector* f = gsl_vector_alloc(n);
+		joint_func(position, &userdata, f);
+		gsl_vector_free(f);
+
+		f = gsl_multifit_nlinear_residual(workspace);
+		gsl_blas_ddot(f, f, &cost);
+
+		converged = (status == GSL_SUCCESS);
+
+		if (converged and n > P)
+		{
+			gsl_matrix* covar = gsl_matrix_alloc(P, P);
+			gsl_multifit_nlinear_covar(gsl_multifit_nlinear_jac(workspace), 0.0, covar);
+			to_external_covariance(transforms, position, covar);
+
+			fit_detail::scaled_standard_errors(covar, cost, n, standard_errors);
+			gsl_matrix_free(covar);
+		}
+
+		if (status == GSL_EMAXITER)
+		{
+			throw std::runtime_error("Max iterations reached before converging.");
+		}
+		else if (status == GSL_ENOPROG)
+		{
+			throw std::runtime_error("Convergence too slow, exiting.");
+		}
+		else if (status != GSL_SUCCESS)
+		{
+			throw std::runtime_error("Joint fit failed: " + std::string(gsl_strerror(status)));
+		}
+
+		BOOST_LOG_TRIVIAL(info) << "Joint fit of " << datasets.size() << " data sets converged.";
+
+		for (size_t i = 0 ; i < P ; ++i)
+		{
+			BOOST_LOG_TRIVIAL(info) << "Standard error " << i << ": " << standard_errors[i];
+		}
+
+		return 0;
+	}
+};
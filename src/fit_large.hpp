@@ -0,0 +1,447 @@
+#pragma once
+
+/*
+ *  This file is part of Lime, a tool for the application of Likhtman & McLiesh' model for polymer dyanmics.
+ *
+ *  Copyright © 2020 Daniel Emmery (CNRS)
+ *
+ *  File contents:
+ *
+ *  Fit Likhtman & McLeish' model to large data sets in bounded memory
+ *
+ *  GPL 3.0 License
+ *
+ */
+
+#include <tuple>
+#include <array>
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+
+#include <gsl/gsl_matrix.h>
+#include <gsl/gsl_vector.h>
+#include <gsl/gsl_blas.h>
+#include <gsl/gsl_multilarge_nlinear.h>
+
+#include "lime_log_utils.hpp"
+#include "parallel_policy.hpp"
+#include "time_series.hpp"
+#include "result.hpp"
+#include "parameter_transform.hpp"
+#include "fit_common.hpp"
+#include "utilities.hpp"
+
+// Same residuals as Fit, but the n x p Jacobian is never stored. The normal equations solver only needs
+// J^T J, J^T u and J u, which are accumulated over chunks of the time range from a finite difference Jacobian.
+template <typename... T>
+struct Large_fit
+{
+	static constexpr size_t p = sizeof...(T);
+
+	using Transform_ptr = std::shared_ptr<const IParameter_transform>;
+	using Transforms = std::array<Transform_ptr, p>;
+
+	struct User_data
+  	{
+		const Time_series::value_type* fitting_data_points;
+		std::tuple<T&...>* free_variables;
+		const Transforms* transforms;
+		ICS_result* result;
+		const double* sqrt_weights;
+		size_t chunk_size;
+		gsl_multilarge_nlinear_fdtype fdtype;
+		double h_df;
+		// Scratch space for a single chunk
+		double* chunk_model;
+		double* chunk_step;
+		double* chunk_jacobian;
+		// A single chunk Jacobian covers the whole time range and is reused while GSL asks for products at the same x
+		std::array<double, p> jacobian_x;
+		bool jacobian_cached;
+	};
+
+	gsl_multilarge_nlinear_workspace *workspace;
+	gsl_multilarge_nlinear_fdf function;
+	gsl_multilarge_nlinear_parameters fdf_params;
+	const gsl_multilarge_nlinear_type *algorithm;
+	std::tuple<T&...> free_variables;
+	void (*callback_func)(const size_t iter, void*, const gsl_multilarge_nlinear_workspace *w);
+	void* callback_params;
+	// Number of time points evaluated at once, bounds the memory used for the Jacobian to chunk_size x p
+	size_t chunk_size;
+	Transforms transforms;
+	std::array<double, p> standard_errors;
+	bool converged;
+
+	Large_fit(T&... free_variables_)
+	: workspace{nullptr},
+	  function{},
+	  fdf_params{gsl_multilarge_nlinear_default_parameters()},
+	  algorithm{gsl_multilarge_nlinear_trust},
+	  free_variables{free_variables_...},
+	  callback_func{&default_callback},
+	  callback_params{nullptr},
+	  chunk_size{1 << 16},
+	  transforms{},
+	  standard_errors{},
+	  converged{false}
+	{
+		transforms.fill(std::make_shared<Identity_transform>());
+
+		fdf_params.scale = gsl_multilarge_nlinear_scale_more;
+		fdf_params.trs = gsl_multilarge_nlinear_trs_subspace2D;
+		fdf_params.solver = gsl_multilarge_nlinear_solver_cholesky;
+		fdf_params.fdtype = GSL_MULTILARGE_NLINEAR_CTRDIFF;
+		fdf_params.factor_up = 3;
+		fdf_params.factor_down = 2;
+	}
+
+	void
+	set_transform(size_t index, Transform_ptr transform)
+	{
+		transforms.at(index) = transform;
+	}
+
+	void
+	use_log_transform()
+	{
+		transforms.fill(std::make_shared<Log_transform>());
+	}
+
+ 	static void
+	default_callback(const size_t iter, void *, const gsl_multilarge_nlinear_workspace *w)
+	{
+		gsl_vector *f = gsl_multilarge_nlinear_residual(w);
+		gsl_vector *x = gsl_multilarge_nlinear_position(w);
+
+		const User_data* userdata = static_cast<const User_data*>(w->fdf->params);
+
+		std::stringstream out;
+
+		out << fit_detail::iteration_message(iter, x, *userdata->transforms);
+		out << ", |f(x)| = " << gsl_blas_dnrm2(f);
+
+		BOOST_LOG_TRIVIAL(info) << out.str();
+	}
+
+	// Moves the context to the external values of x
+	static
+	void
+	apply(const gsl_vector* x, const User_data& userdata)
+	{
+		fit_detail::to_external(x, *userdata.transforms, *userdata.free_variables);
+
+		userdata.result->context_->apply_physics();
+	}
+
+	// GSL does not apply weights to a user supplied Jacobian, so the residuals carry them instead
+	static
+	int
+	large_func(const gsl_vector* x, void* data, gsl_vector* f)
+	{
+		const User_data& userdata = *static_cast<User_data*>(data);
+		const auto& data_points = *userdata.fitting_data_points;
+		const size_t n = data_points.size();
+
+		apply(x, userdata);
+
+		for (size_t first = 0 ; first < n ; first += userdata.chunk_size)
+		{
+			const size_t last = std::min(first + userdata.chunk_size, n);
+
+			userdata.result->calculate(first, last, userdata.chunk_model);
+
+			for (size_t j = first ; j < last ; ++j)
+			{
+				gsl_vector_set(f, j, userdata.sqrt_weights[j] * (data_points[j] - userdata.chunk_model[j - first]) / data_points[j]);
+			}
+		}
+
+		return GSL_SUCCESS;
+	}
+
+	// Finite difference Jacobian of the chunk [first, last), stored row major in chunk_jacobian.
+	// Forward: dm/dx_k = (m(x + h e_k) - m(x)) / h, central: dm/dx_k = (m(x + h/2 e_k) - m(x - h/2 e_k)) / h
+	static
+	void
+	jacobian_chunk(const gsl_vector* x, User_data& userdata, size_t first, size_t last)
+	{
+		const auto& data_points = *userdata.fitting_data_points;
+		const size_t rows = last - first;
+		const bool central = userdata.fdtype == GSL_MULTILARGE_NLINEAR_CTRDIFF;
+
+		double x_step_data[p];
+		gsl_vector_view x_step = gsl_vector_view_array(x_step_data, p);
+
+		if (not central)
+		{
+			apply(x, userdata);
+			userdata.result->calculate(first, last, userdata.chunk_model);
+		}
+
+		for (size_t k = 0 ; k < p ; ++k)
+		{
+			const double x_k = gsl_vector_get(x, k);
+			const double h = userdata.h_df * (x_k == 0.0 ? 1.0 : std::fabs(x_k));
+
+			gsl_vector_memcpy(&x_step.vector, x);
+			gsl_vector_set(&x_step.vector, k, central ? x_k + 0.5*h : x_k + h);
+			apply(&x_step.vector, userdata);
+			userdata.result->calculate(first, last, userdata.chunk_step);
+
+			for (size_t r = 0 ; r < rows ; ++r)
+			{
+				userdata.chunk_jacobian[r*p + k] = userdata.chunk_step[r] - (central ? 0.0 : userdata.chunk_model[r]);
+			}
+
+			if (central)
+			{
+				gsl_vector_set(&x_step.vector, k, x_k - 0.5*h);
+				apply(&x_step.vector, userdata);
+				userdata.result->calculate(first, last, userdata.chunk_step);
+
+				for (size_t r = 0 ; r < rows ; ++r)
+				{
+					userdata.chunk_jacobian[r*p + k] -= userdata.chunk_step[r];
+				}
+			}
+
+			// The residual is sqrt(w) (y - m) / y
+			for (size_t r = 0 ; r < rows ; ++r)
+			{
+				const size_t j = first + r;
+				userdata.chunk_jacobian[r*p + k] *= -userdata.sqrt_weights[j] / (data_points[j] * h);
+			}
+		}
+	}
+
+	static
+	bool
+	at_cached_jacobian(const gsl_vector* x, const User_data& userdata)
+	{
+		if (not userdata.jacobian_cached)
+		{
+			return false;
+		}
+
+		for (size_t k = 0 ; k < p ; ++k)
+		{
+			if (gsl_vector_get(x, k) != userdata.jacobian_x[k])
+			{
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	// Depending on the arguments GSL asks for v = J u (u of size p), v = J^T u (u of size n) and/or J^T J
+	static
+	int
+	large_df(CBLAS_TRANSPOSE_t TransJ, const gsl_vector* x, const gsl_vector* u, void* data, gsl_vector* v, gsl_matrix* JTJ)
+	{
+		User_data& userdata = *static_cast<User_data*>(data);
+		const size_t n = userdata.fitting_data_points->size();
+		// With several chunks only one is held at a time, so their Jacobians are recomputed on every call
+		const bool single_chunk = n <= userdata.chunk_size;
+
+		if (JTJ)
+		{
+			gsl_matrix_set_zero(JTJ);
+		}
+
+		if (u and TransJ == CblasTrans)
+		{
+			gsl_vector_set_zero(v);
+		}
+
+		for (size_t first = 0 ; first < n ; first += userdata.chunk_size)
+		{
+			const size_t last = std::min(first + userdata.chunk_size, n);
+
+			if (not single_chunk or not at_cached_jacobian(x, userdata))
+			{
+				jacobian_chunk(x, userdata, first, last);
+			}
+
+			if (single_chunk)
+			{
+				for (size_t k = 0 ; k < p ; ++k)
+				{
+					userdata.jacobian_x[k] = gsl_vector_get(x, k);
+				}
+
+				userdata.jacobian_cached = true;
+			}
+
+			for (size_t j = first ; j < last ; ++j)
+			{
+				const double* J_j = userdata.chunk_jacobian + (j - first)*p;
+
+				if (JTJ)
+				{
+					for (size_t a = 0 ; a < p ; ++a)
+					{
+						for (size_t b = 0 ; b <= a ; ++b)
+						{
+							*gsl_matrix_ptr(JTJ, a, b) += J_j[a] * J_j[b];
+						}
+					}
+				}
+
+				if (u and TransJ == CblasTrans)
+				{
+					const double u_j = gsl_vector_get(u, j);
+
+					for (size_t a = 0 ; a < p ; ++a)
+					{
+						*gsl_vector_ptr(v, a) += J_j[a] * u_j;
+					}
+				}
+				else if (u)
+				{
+					double Ju{0.0};
+
+					for (size_t a = 0 ; a < p ; ++a)
+					{
+						Ju += J_j[a] * gsl_vector_get(u, a);
+					}
+
+					gsl_vector_set(v, j, Ju);
+				}
+			}
+		}
+
+		if (JTJ)
+		{
+			for (size_t a = 0 ; a < p ; ++a)
+			{
+				for (size_t b = a + 1 ; b < p ; ++b)
+				{
+					gsl_matrix_set(JTJ, a, b, gsl_matrix_get(JTJ, b, a));
+				}
+			}
+		}
+
+		apply(x, userdata);
+
+		return GSL_SUCCESS;
+	}
+
+	int
+	fit(const Time_series::value_type& fitting_data, ICS_result& driver, double wt_pow = 1.2)
+	{
+		const size_t n = fitting_data.size();
+
+		if (chunk_size == 0)
+		{
+			throw std::runtime_error("Chunk size for large data fitting should be positive.");
+		}
+
+		if (n != driver.size())
+		{
+			throw std::runtime_error("Number of data points does not match the time range of the result.");
+		}
+
+		const size_t chunk = std::min(chunk_size, n);
+
+		const std::vector<double> sqrt_weights = fit_detail::data_weights(fitting_data, 0.5*wt_pow);
+		std::vector<double> chunk_model(chunk);
+		std::vector<double> chunk_step(chunk);
+		std::vector<double> chunk_jacobian(chunk * p);
+
+		User_data userdata
+		{
+			&fitting_data,
+			&free_variables,
+			&transforms,
+			&driver,
+			sqrt_weights.data(),
+			chunk,
+			fdf_params.fdtype,
+			fdf_params.h_df,
+			chunk_model.data(),
+			chunk_step.data(),
+			chunk_jacobian.data(),
+			{},
+			false
+		};
+
+		double x_init[p];
+
+		fit_detail::to_internal(free_variables, transforms, x_init);
+
+		gsl_vector_view x = gsl_vector_view_array(x_init, p);
+
+		double chisq;
+		int status, info;
+
+		const double xtol = 1e-14;
+		const double gtol = 1e-14;
+		const double ftol = 1e-14;
+
+		function.f = &large_func;
+		function.df = &large_df;
+		function.fvv = nullptr;
+		function.n = n;
+		function.p = p;
+		function.params = &userdata;
+
+		/* owned so evaluations that throw don't leak it */
+		std::unique_ptr<gsl_multilarge_nlinear_workspace, decltype(&gsl_multilarge_nlinear_free)> workspace_owner{
+			gsl_multilarge_nlinear_alloc(algorithm, &fdf_params, n, p), &gsl_multilarge_nlinear_free};
+
+		if (workspace_owner == nullptr)
+		{
+			throw std::runtime_error("Could not allocate fitting solver: likely out of memory.");
+		}
+
+		workspace = workspace_owner.get();
+		Scope_guard forget_workspace{[this]() { workspace = nullptr; }};
+
+		gsl_multilarge_nlinear_init(&x.vector, &function, workspace);
+
+		status = gsl_multilarge_nlinear_driver(100, xtol, gtol, ftol, callback_func, callback_params, &info, workspace);
+
+		gsl_blas_ddot(gsl_multilarge_nlinear_residual(workspace), gsl_multilarge_nlinear_residual(workspace), &chisq);
+
+		/* parameter uncertainties from J^T J, scaled by the goodness of fit */
+		if (n > p)
+		{
+			gsl_matrix* covar = gsl_matrix_alloc(p, p);
+			gsl_multilarge_nlinear_covar(covar, workspace);
+			to_external_covariance(transforms, gsl_multilarge_nlinear_position(workspace), covar);
+			fit_detail::scaled_standard_errors(covar, chisq, n, standard_errors);
+			gsl_matrix_free(covar);
+		}
+
+		// Leave the context and result at the solution rather than at the last finite difference step
+		apply(gsl_multilarge_nlinear_position(workspace), userdata);
+		driver.calculate();
+
+		converged = status == GSL_SUCCESS;
+
+		if (status == GSL_SUCCESS)
+		{
+			BOOST_LOG_TRIVIAL(info) << "Fit converged.";
+
+			for (size_t i = 0 ; i < p ; ++i)
+			{
+				BOOST_LOG_TRIVIAL(info) << "Standard error " << i << ": " << standard_errors[i];
+			}
+		}
+		else if (status == GSL_EMAXITER)
+		{
+			throw std::runtime_error("Max iterations reached before converging.");
+		}
+		else if (status == GSL_ENOPROG)
+		{
+			throw std::runtime_error("Convergence too slow, exiting.");
+		}
+		return 0;
+	}
+};
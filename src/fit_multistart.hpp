@@ -0,0 +1,218 @@
+#pragma once
+
+/*
+ *  This file is part of Lime, a tool for the application of Likhtman & McLiesh' model for polymer dyanmics.
+ *
+ *  Copyright © 2020 Daniel Emmery (CNRS)
+ *
+ *  File contents:
+ *
+ *  Global fitting by running local fits from many initial points
+ *
+ *  GPL 3.0 License
+ *
+ */
+
+#include <array>
+#include <vector>
+#include <atomic>
+#include <algorithm>
+#include <numeric>
+#include <random>
+#include <cmath>
+#include <limits>
+#include <functional>
+#include <stdexcept>
+
+#include <gsl/gsl_qrng.h>
+
+#include "lime_log_utils.hpp"
+#include "parallel_policy.hpp"
+#include "parameter_transform.hpp"
+
+enum class Sampling
+{
+    LATIN_HYPERCUBE,
+    SOBOL
+};
+
+template <size_t P>
+using Start_point = std::array<double, P>;
+
+template <size_t P>
+struct Start_result
+{
+    Start_point<P> initial;
+    Start_point<P> solution;
+    double cost;
+    bool pruned;
+    bool converged;
+};
+
+template <size_t P>
+struct Minimum
+{
+    Start_point<P> solution;
+    double cost;
+    // Number of starts that ended up in this minimum
+    size_t starts;
+};
+
+// Maps [0,1] onto the bounds, logarithmically when both bounds are positive as parameters tend to span decades.
+// Points stay a small margin away from the bounds, which sigmoid transforms can't reach.
+inline double
+from_unit_interval(double unit, const Bounds& bounds)
+{
+    static constexpr double margin = 1e-6;
+
+    if (not bounds.bounded())
+    {
+        throw std::runtime_error("Sampling initial points requires finite bounds for all free variables.");
+    }
+
+    unit = margin + (1.0 - 2.0*margin) * unit;
+
+    if (bounds.lower > 0.0)
+    {
+        return std::exp(std::log(bounds.lower) + unit * (std::log(bounds.upper) - std::log(bounds.lower)));
+    }
+    else
+    {
+        return bounds.lower + unit * (bounds.upper - bounds.lower);
+    }
+}
+
+template <size_t P>
+std::vector<Start_point<P>>
+sample_starts(const std::array<Bounds, P>& bounds, size_t count, Sampling sampling, unsigned int seed = 0)
+{
+    std::vector<Start_point<P>> points(count);
+
+    if (sampling == Sampling::SOBOL)
+    {
+        gsl_qrng* sobol = gsl_qrng_alloc(gsl_qrng_sobol, P);
+        double unit[P];
+
+        // The first point of the sequence is the origin, which would sit on the lower bounds
+        gsl_qrng_get(sobol, unit);
+
+        for (auto& point : points)
+        {
+            gsl_qrng_get(sobol, unit);
+
+            for (size_t i = 0 ; i < P ; ++i)
+            {
+                point[i] = from_unit_interval(unit[i], bounds[i]);
+            }
+        }
+
+        gsl_qrng_free(sobol);
+    }
+    else
+    {
+        // Every parameter gets one point in each of count strata, the strata are shuffled independently per parameter
+        std::mt19937 generator(seed);
+        std::uniform_real_distribution<double> uniform(0.0, 1.0);
+        std::vector<size_t> strata(count);
+
+        for (size_t i = 0 ; i < P ; ++i)
+        {
+            std::iota(strata.begin(), strata.end(), 0);
+            std::shuffle(strata.begin(), strata.end(), generator);
+
+            for (size_t j = 0 ; j < count ; ++j)
+            {
+                const double unit = (static_cast<double>(strata[j]) + uniform(generator)) / static_cast<double>(count);
+                points[j][i] = from_unit_interval(unit, bounds[i]);
+            }
+        }
+    }
+
+    return points;
+}
+
+// Runs fit_start(initial, stop) for every initial point on the thread pool, and returns the results sorted by cost.
+// fit_start should hand stop to its fit (see Fit::stop): starts whose cost is still prune_factor times the best cost
+// seen by any start after prune_after iterations are ended early.
+template <size_t P, typename Fit_start>
+std::vector<Start_result<P>>
+run_multistart(const std::vector<Start_point<P>>& initial_points, Fit_start fit_start, double prune_factor = 10.0, size_t prune_after = 10)
+{
+    std::atomic<double> best_cost{std::numeric_limits<double>::infinity()};
+    std::vector<Start_result<P>> results(initial_points.size());
+    std::vector<size_t> indices(initial_points.size());
+    std::iota(indices.begin(), indices.end(), 0);
+
+    // Every cost seen belongs to a reachable point, so it bounds the best cost
+    auto update_best = [&best_cost](double cost) {
+        double best = best_cost.load();
+        while (cost < best and not best_cost.compare_exchange_weak(best, cost));
+    };
+
+    with_task_policy([&](const auto& policy) {
+        std::for_each(policy, indices.begin(), indices.end(), [&](size_t i) {
+            const std::function<bool(size_t, double)> stop = [&best_cost, &update_best, prune_factor, prune_after](size_t iteration, double cost) {
+                update_best(cost);
+                return iteration >= prune_after and cost > prune_factor * best_cost.load();
+            };
+
+            // Exceptions can't leave a parallel algorithm
+            try
+            {
+                results[i] = fit_start(initial_points[i], stop);
+            }
+            catch (const std::exception& e)
+            {
+                BOOST_LOG_TRIVIAL(warning) << "Start " << i << " failed: " << e.what();
+                results[i] = Start_result<P>{initial_points[i], initial_points[i], std::numeric_limits<double>::infinity(), false};
+            }
+
+            update_best(results[i].cost);
+        });
+    });
+
+    std::sort(results.begin(), results.end(), [](const auto& a, const auto& b) { return a.cost < b.cost; });
+
+    return results;
+}
+
+// Groups the unpruned, finished starts into distinct minima. Solutions belong to the same minimum when all parameters
+// agree to within a relative tolerance. Expects results sorted by cost, so the first start of a minimum is its best.
+template <size_t P>
+std::vector<Minimum<P>>
+cluster_minima(const std::vector<Start_result<P>>& results, double tolerance = 0.05)
+{
+    std::vector<Minimum<P>> minima;
+
+    auto same = [tolerance](const Start_point<P>& a, const Start_point<P>& b) {
+        for (size_t i = 0 ; i < P ; ++i)
+        {
+            if (std::abs(a[i] - b[i]) > tolerance * std::max(std::abs(a[i]), std::abs(b[i])))
+            {
+                return false;
+            }
+        }
+        return true;
+    };
+
+    for (const auto& result : results)
+    {
+        if (result.pruned or not std::isfinite(result.cost))
+        {
+            continue;
+        }
+
+        auto minimum = std::find_if(minima.begin(), minima.end(), [&](const auto& m) { return same(m.solution, result.solution); });
+
+        if (minimum == minima.end())
+        {
+            minima.push_back(Minimum<P>{result.solution, result.cost, 1});
+        }
+        else
+        {
+            ++minimum->starts;
+        }
+    }
+
+    return minima;
+}
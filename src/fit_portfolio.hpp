@@ -0,0 +1,97 @@
+#pragma once
+
+/*
+ *  This file is part of Lime, a tool for the application of Likhtman & McLiesh' model for polymer dyanmics.
+ *
+ *  Copyright © 2020 Daniel Emmery (CNRS)
+ *
+ *  File contents:
+ *
+ *  Race several solver strategies from the same initial point
+ *
+ *  GPL 3.0 License
+ *
+ */
+
+#include <vector>
+#include <atomic>
+#include <algorithm>
+#include <numeric>
+#include <limits>
+#include <functional>
+#include <stdexcept>
+#include <cmath>
+
+#include "lime_log_utils.hpp"
+#include "parallel_policy.hpp"
+#include "fit.hpp"
+
+// What the fit of one strategy ended with
+struct Strategy_outcome
+{
+	bool converged;
+	double cost;
+};
+
+// Runs fit_strategy(index, stop) for all strategies concurrently, where fit_strategy returns the Strategy_outcome of its fit.
+// As soon as one strategy converges stop starts returning true for all others, which should hand it to their fit
+// (see Fit::stop) to end after their current iteration. Returns the index of the strategy that converged first.
+// If none converged, like when a time budget cancelled them all, returns the strategy with the lowest finite cost.
+template <typename Fit_strategy>
+size_t
+race_strategies(const std::vector<Strategy>& strategies, Fit_strategy fit_strategy)
+{
+	static constexpr size_t none = std::numeric_limits<size_t>::max();
+
+	std::atomic<size_t> winner{none};
+	std::vector<double> costs(strategies.size(), std::numeric_limits<double>::infinity());
+	std::vector<size_t> indices(strategies.size());
+	std::iota(indices.begin(), indices.end(), 0);
+
+	with_task_policy([&](const auto& policy) {
+		std::for_each(policy, indices.begin(), indices.end(), [&](size_t i) {
+			const std::function<bool(size_t, double)> stop = [&winner](size_t, double) {
+				return winner.load() != none;
+			};
+
+			// Exceptions can't leave a parallel algorithm
+			try
+			{
+				const Strategy_outcome outcome = fit_strategy(i, stop);
+
+				if (std::isfinite(outcome.cost))
+				{
+					costs[i] = outcome.cost;
+				}
+
+				if (outcome.converged)
+				{
+					size_t expected = none;
+					winner.compare_exchange_strong(expected, i);
+				}
+			}
+			catch (const std::exception& e)
+			{
+				BOOST_LOG_TRIVIAL(warning) << "Strategy " << strategies[i].name << " failed: " << e.what();
+			}
+		});
+	});
+
+	if (winner.load() != none)
+	{
+		BOOST_LOG_TRIVIAL(info) << "Strategy " << strategies[winner.load()].name << " converged first.";
+
+		return winner.load();
+	}
+
+	const size_t best = static_cast<size_t>(std::distance(costs.begin(), std::min_element(costs.begin(), costs.end())));
+
+	if (not std::isfinite(costs[best]))
+	{
+		throw std::runtime_error("None of the solver strategies finished.");
+	}
+
+	BOOST_LOG_TRIVIAL(warning) << "None of the solver strategies converged, keeping " << strategies[best].name << " with the lowest cost " << costs[best] << ".";
+
+	return best;
+}
@@ -32,7 +32,20 @@
 #include "writer.hpp"
 #include "tube.hpp"
 #include "fit.hpp"
+#include "fit_large.hpp"
+#include "fit_multistart.hpp"
+#include "fit_portfolio.hpp"
+#include "fit_bootstrap.hpp"
+#include "fit_joint.hpp"
+#include "sampler.hpp"
+#include "surrogate.hpp"
+#include "log_grid.hpp"
+#include "warm_start.hpp"
+#include "checkpoint.hpp"
+#include "parameter_transform.hpp"
 #include "postprocess.hpp"
+#include "buffer_pool.hpp"
+#include "autotune.hpp"
 
 #include <unordered_map>
 #include <filesystem>
@@ -40,10 +53,14 @@
 #include <tuple>
 #include <numeric>
 #include <cmath>
+#include <optional>
+#include <sstream>
 
 static Register_class<IConstraint_release, RUB_constraint_release, constraint_release::impl, double, Context&> rubinstein_constraint_release_factory(constraint_release::impl::RUBINSTEINCOLBY);
 static Register_class<IConstraint_release, HEU_constraint_release, constraint_release::impl, double, Context&> heuzey_constraint_release_factory(constraint_release::impl::HEUZEY);
 static Register_class<IConstraint_release, DR_constraint_release, constraint_release::impl, double, Context&> dr_constraint_release_factory(constraint_release::impl::DOUBLEREPTATION);
+// Rubinstein & Colby's constraint release doesn't observe the context during fits
+static Register_class<IConstraint_release, RUB_constraint_release, constraint_release::impl, double, double, double, double, double> rubinstein_detached_constraint_release_factory(constraint_release::impl::RUBINSTEINCOLBY);
 
 struct lime : args::group<lime>
 {
@@ -59,11 +76,24 @@ struct lime : args::group<lime>
             boost::log::core::get()->set_filter(boost::log::trivial::severity >= boost::log::trivial::debug);
         };
 
+        auto set_threads = [](auto&& val, const auto&, const args::argument&) {
+            Execution_context::get().set_num_threads(val);
+        };
+
+        auto set_profile = [](auto&& val, const auto&, const args::argument&) {
+            Autotuner::get().set_profile(val);
+        };
+
         f(nullptr, "-v", "--version", args::help("Print version"), args::show(PROJECT_VER));
         f(nullptr,  "-D", "--debug",   args::help("Enable debugging"), args::lazy_callback(debug)  );
+        f(threads, "--threads", args::help("Maximum number of threads to use, 0 uses all"), args::lazy_callback(set_threads));
+        f(tuning_profile, "--tuningprofile", args::help("File to read and store the measured costs and parallelization of the kernels in"), args::lazy_callback(set_profile));
     }
 
-    lime() {}
+    size_t threads;
+    std::filesystem::path tuning_profile;
+
+    lime() : threads{0} {}
 
     void run() {}
 };
@@ -119,7 +149,7 @@ struct cmd_can_output_terms
         {
             writer_ref.set_filename("escape_term_" + original_filename);
 
-            writer_ref << (*res.CR)(time) * (*res.CLF)(time) * (4.0 / 5.0);
+            writer_ref << Time_series((*res.CR)(time) * (*res.CLF)(time) * (4.0 / 5.0));
         }
 
         if (term_two)
@@ -149,12 +179,25 @@ struct result_cmd
     constraint_release::impl CR_impl;
     
     double c_v;
+    Precision precision;
+    bool pool;
 
-    result_cmd() : ctx{std::make_shared<Context>()}, system{std::make_shared<System>()}, CR_impl{constraint_release::impl::HEUZEY}, c_v{0.1}
+    result_cmd() : ctx{std::make_shared<Context>()}, system{std::make_shared<System>()}, CR_impl{constraint_release::impl::HEUZEY}, c_v{0.1}, precision{Precision::DOUBLE}, pool{false}
     {
         system->T = 1.0;
     }
 
+    ~result_cmd()
+    {
+#ifdef POOL_STATISTICS
+        if (pool)
+        {
+            const auto statistics = Buffer_pool::statistics();
+            BOOST_LOG_TRIVIAL(info) << "Buffer pool: " << statistics.allocated << " buffers allocated, " << statistics.reused << " reused, " << statistics.released << " released.";
+        }
+#endif
+    }
+
     template<class F>
     void parse(F f)
     {
@@ -166,6 +209,18 @@ struct result_cmd
         f(c_v,               "-c", "--crparameter",              args::help("Constraint release parameter"),                 args::required());
         f(CR_impl, "--rub", args::help("Use Rubinstein&Colby constraint release (mutually exclusive with --doublerep)"), args::exclude("--doublerep"), args::set(constraint_release::impl::RUBINSTEINCOLBY));
         f(CR_impl, "--doublerep", args::help("Use double reptation for constraint release"), args::set(constraint_release::impl::DOUBLEREPTATION));
+        f(precision, "--float", args::help("Evaluate constraint release in single precision, faster but less accurate, for screening parameters. Ignored when fitting"), args::set(Precision::SINGLE));
+        f(pool, "--pool", args::help("Recycle the buffers of repeatedly evaluated results instead of allocating them anew"), args::set(true));
+    }
+
+    // Single precision is meant for screening, fitted parameters and their errors would carry its error
+    void ignore_single_precision()
+    {
+        if (precision == Precision::SINGLE)
+        {
+            BOOST_LOG_TRIVIAL(warning) << "Fitting does not support --float, ignoring it.";
+            precision = Precision::DOUBLE;
+        }
     }
 
     template <typename builder_t = ICS_context_builder>
@@ -183,9 +238,60 @@ struct result_cmd
         view = builder->context_view();
 
         driver.CR->c_v_ = c_v;
+        driver.CR->set_precision(precision);
+        if (pool)
+            driver.pool_scope = std::make_shared<const Buffer_pool::Scope>();
 
         return driver;
     }
+
+    // Result with its own copy of the context, which can be used concurrently with other results
+    // impl overrides the constraint release selected on the command line
+    // A Rubinstein & Colby model that doesn't observe its context shares the spectrum of kernels, if given, instead of drawing one
+    template <typename builder_t = ICS_context_builder>
+    ICS_result build_detached_result(Time_series::time_type time, bool observes_context = true, std::optional<constraint_release::impl> impl = std::nullopt,
+        const ICS_result* kernels = nullptr) const
+    {
+        auto context = std::make_shared<Context>();
+        copy_parameters(*ctx, *context);
+
+        builder_t builder(system, context);
+
+        const auto source = kernels ? dynamic_cast<const RUB_constraint_release*>(kernels->CR.get()) : nullptr;
+        const bool shares_spectrum = source and not observes_context and impl.value_or(CR_impl) == constraint_release::impl::RUBINSTEINCOLBY;
+
+        ICS_result driver = shares_spectrum
+            ? ICS_result(time, &builder, constraint_release::impl::RUBINSTEINCOLBY, std::make_unique<RUB_constraint_release>(c_v, *source))
+            : ICS_result(time, &builder, impl.value_or(CR_impl), observes_context);
+
+        driver.CR->c_v_ = c_v;
+        driver.CR->set_precision(precision);
+        if (pool)
+            driver.pool_scope = std::make_shared<const Buffer_pool::Scope>();
+
+        return driver;
+    }
+};
+
+struct cmd_has_parameter_bounds
+{
+    Bounds N_e_bounds;
+    Bounds tau_monomer_bounds;
+    Bounds G_e_bounds;
+
+    template<class F>
+    void parse(F f)
+    {
+        f(N_e_bounds,         "--nebounds",     args::help("Bounds for the number of monomers per entanglement, as lower:upper"));
+        f(tau_monomer_bounds, "--taubounds",    args::help("Bounds for the monomer relaxation time, as lower:upper"));
+        f(G_e_bounds,         "--gebounds",     args::help("Bounds for the entanglement modulus, as lower:upper. Only used when decouple=true"));
+    }
+
+    // Ordered like the free variables of a fit: N_e, tau_monomer, G_e
+    std::array<Bounds, 3> get_bounds() const
+    {
+        return {N_e_bounds, tau_monomer_bounds, G_e_bounds};
+    }
 };
 
 struct cmd_generates_exponential_timescale
@@ -234,7 +340,9 @@ struct cmd_takes_file_input
 
 struct generate : lime::command<generate>, cmd_writes_output_file, result_cmd, cmd_generates_exponential_timescale, cmd_can_output_terms
 {
-    generate() : cmd_can_output_terms(cmd_writes_output_file::writer)
+    size_t chunk_size;
+
+    generate() : cmd_can_output_terms(cmd_writes_output_file::writer), chunk_size{1 << 16}
     {}
 
     static constexpr const char* help()
@@ -249,12 +357,23 @@ struct generate : lime::command<generate>, cmd_writes_output_file, result_cmd, c
         result_cmd::parse(f);
         cmd_writes_output_file::parse(f);
         cmd_can_output_terms::parse(f);
+        f(chunk_size, "--chunksize", args::help("Number of time points evaluated at once, longer time ranges are streamed to the output"));
     }
 
     void run()
     {
         BOOST_LOG_TRIVIAL(info) << "Generating...";
 
+        const auto grid = Log_grid::exponential(base, max_t);
+        chunk_size = std::max<size_t>(chunk_size, 1);
+
+        // The terms are written from a result holding all time points
+        if (grid.size() > chunk_size and not (term_one or term_two or term_three))
+        {
+            stream(grid);
+            return;
+        }
+
         Time_range::type time = Time_range::generate_exponential(base, max_t);
 
         ICS_result result = build_result(time);
@@ -266,6 +385,28 @@ struct generate : lime::command<generate>, cmd_writes_output_file, result_cmd, c
 
         output_terms(result);
     }
+
+    // Evaluates and writes the grid chunk by chunk, only a chunk of time points and values is held at once
+    void stream(const Log_grid& grid)
+    {
+        ICS_result result = build_result(grid.chunk(0, chunk_size));
+
+        BOOST_LOG_TRIVIAL(info) << *view;
+
+        writer << *view;
+
+        for (size_t first = 0 ; first < grid.size() ; first += chunk_size)
+        {
+            const size_t last = std::min(first + chunk_size, grid.size());
+
+            if (first > 0)
+                result.set_time_range(grid.chunk(first, last));
+
+            result.calculate();
+
+            writer << result;
+        }
+    }
 };
 
 struct compare : lime::command<compare>, cmd_takes_file_input, result_cmd
@@ -311,25 +452,61 @@ struct compare : lime::command<compare>, cmd_takes_file_input, result_cmd
 
         if (rmse)
         {
-            BOOST_LOG_TRIVIAL(info) << "RMSE: " << RMSE<Time_series::value_primitive>(result.get_values(), input.get_values());
+            BOOST_LOG_TRIVIAL(info) << "RMSE: " << RMSE<Time_series::value_primitive>(result.values(), input.values());
         }
         if (narmse)
         {
-            BOOST_LOG_TRIVIAL(info) << "NRMSE (by average): " << NRMSE_average<Time_series::value_primitive>(result.get_values(), input.get_values());
+            BOOST_LOG_TRIVIAL(info) << "NRMSE (by average): " << NRMSE_average<Time_series::value_primitive>(result.values(), input.values());
         }
         if (nrrmse)
         {
-            BOOST_LOG_TRIVIAL(info) << "NRMSE (by range): " << NRMSE_range<Time_series::value_primitive>(result.get_values(), input.get_values());
+            BOOST_LOG_TRIVIAL(info) << "NRMSE (by range): " << NRMSE_range<Time_series::value_primitive>(result.values(), input.values());
         }
     }
 };
 
-struct fit : lime::command<fit>, cmd_takes_file_input, cmd_writes_output_file, result_cmd, cmd_can_output_terms
+struct fit : lime::command<fit>, cmd_takes_file_input, cmd_writes_output_file, result_cmd, cmd_can_output_terms, cmd_has_parameter_bounds
 {
     double wt_pow;
     bool decouple;
-
-    fit() : cmd_can_output_terms(cmd_writes_output_file::writer), wt_pow{0.0}, decouple{false}
+    bool geodesic;
+    bool separable;
+    bool log_params;
+    bool large;
+    size_t chunk_size;
+    bool multilevel;
+    size_t points_per_decade;
+    size_t starts;
+    Sampling sampling;
+    bool portfolio;
+    // Set by the portfolio race, used for all following fits
+    std::optional<Strategy> strategy;
+    // Cost of the portfolio winner if it fit the exact model, whose parameters then are in ctx and aren't refit
+    std::optional<double> portfolio_cost;
+    // Unset when no strategy converged before the time budget ran out, and the lowest cost was kept
+    bool portfolio_converged;
+    // Drawn once for the multistart and portfolio searches, the final fit shares its Rubinstein & Colby spectrum
+    std::shared_ptr<const ICS_result> search_kernels;
+    double time_budget;
+    // Shared by all fits of this command
+    std::shared_ptr<const Cancellation_token> cancellation;
+    std::filesystem::path warm_start_path;
+    std::optional<Warm_start_store> warm_start;
+    std::filesystem::path checkpoint_path;
+    size_t checkpoint_interval;
+    bool resume;
+    // Read from checkpoint_path when resuming
+    std::optional<Fit_checkpoint> resumed;
+    size_t replicates;
+    Resampling resampling;
+    size_t block_size;
+    double confidence;
+    bool use_surrogate;
+    size_t surrogate_degree;
+    // Emulator of G(t)/G_e over the bounds of N_e and tau_monomer, set when use_surrogate=true
+    std::shared_ptr<const Chebyshev_emulator<2>> emulator;
+
+    fit() : cmd_can_output_terms(cmd_writes_output_file::writer), wt_pow{0.0}, decouple{false}, geodesic{false}, separable{false}, log_params{false}, large{false}, chunk_size{1 << 16}, multilevel{false}, points_per_decade{10}, starts{0}, sampling{Sampling::LATIN_HYPERCUBE}, portfolio{false}, strategy{}, portfolio_cost{}, portfolio_converged{false}, search_kernels{}, time_budget{0.0}, cancellation{}, warm_start_path{}, warm_start{}, checkpoint_path{}, checkpoint_interval{1}, resume{false}, resumed{}, replicates{0}, resampling{Resampling::RESIDUALS}, block_size{0}, confidence{0.95}, use_surrogate{false}, surrogate_degree{8}, emulator{}
     {}
     
     static const char* help()
@@ -344,9 +521,492 @@ struct fit : lime::command<fit>, cmd_takes_file_input, cmd_writes_output_file, r
         result_cmd::parse(f);
         cmd_writes_output_file::parse(f);
         cmd_can_output_terms::parse(f);
+        cmd_has_parameter_bounds::parse(f);
         f(wt_pow,   "-w", "--weightpower",         args::help("Set power for the weighting factor 1/(x^wt)") );
         f(decouple, "--decouple",                  args::help("Decouple G_e and M_e"), args::set(true));
         f(ctx->G_e, "-g", "--entanglementmodulus", args::help("Set initial guess for entanglement modulus, only used when decouple=true") );
+        f(geodesic, "--geodesic",                  args::help("Use Levenberg-Marquardt with geodesic acceleration, useful for narrow valleys"), args::set(true));
+        f(separable, "--separable",                args::help("Solve the entanglement modulus analytically at every iteration, only used when decouple=true"), args::set(true));
+        f(log_params, "--logparams",               args::help("Fit the logarithm of unbounded free variables, which keeps them positive"), args::set(true));
+        f(large,    "--large",                     args::help("Solve the normal equations over chunks of the data, for data sets too large for the default solver"), args::set(true));
+        f(chunk_size, "--chunksize",               args::help("Number of data points evaluated at once, only used when large=true"));
+        f(multilevel, "--multilevel",              args::help("Fit log decimated subsets of the data first, refining up to the full data"), args::set(true));
+        f(points_per_decade, "--pointsperdecade",  args::help("Points per decade of the coarsest level, only used when multilevel=true"));
+        f(starts,   "--multistart",                args::help("Number of initial points sampled within the bounds, fitted concurrently before the final fit"));
+        f(sampling, "--sobol",                     args::help("Sample multistart initial points from a Sobol sequence instead of a Latin hypercube"), args::set(Sampling::SOBOL));
+        f(time_budget, "--time-budget",            args::help("Wall clock time in seconds after which fitting stops and returns the best parameters found so far"));
+        f(warm_start_path, "--warmstart",          args::help("Store of converged fits: start from the nearest stored fit of the same model, and record this fit when it converges"));
+        f(portfolio, "--portfolio",                args::help("Race several trust region strategies concurrently and keep the first to converge"), args::set(true));
+        f(checkpoint_path, "--checkpoint",         args::help("Write the state of the fit to this file every few iterations"));
+        f(checkpoint_interval, "--checkpointinterval", args::help("Iterations between checkpoints, only used with --checkpoint"));
+        f(resume,   "--resume",                    args::help("Continue the fit from the file given by --checkpoint"), args::set(true));
+        f(replicates, "--bootstrap",               args::help("Number of bootstrap replicates fitted concurrently to estimate confidence intervals of the fitted parameters"));
+        f(resampling, "--blockbootstrap",          args::help("Resample blocks of consecutive residuals instead of single residuals"), args::set(Resampling::BLOCKS));
+        f(block_size, "--blocksize",               args::help("Residuals per block, only used when blockbootstrap=true. Defaults to the cube root of the number of data points"));
+        f(confidence, "--confidence",              args::help("Confidence level of the bootstrap intervals, defaults to 0.95"));
+        f(use_surrogate, "--surrogate",            args::help("Fit on an emulator of the model built within the bounds of N_e and tau_monomer first, then polish with the exact model"), args::set(true));
+        f(surrogate_degree, "--surrogatedegree",   args::help("Degree of the emulator per parameter, only used when surrogate=true. At most 31, defaults to 8"));
+    }
+
+    template <typename Driver>
+    void solve(Driver& fit_driver, const Time_series::value_type& data, ICS_result& result)
+    {
+        if (multilevel)
+            fit_multilevel(fit_driver, data, result, wt_pow, points_per_decade);
+        else
+            fit_driver.fit(data, result, wt_pow);
+    }
+
+    template <typename Driver>
+    void set_transforms(Driver& fit_driver)
+    {
+        const auto bounds = get_bounds();
+
+        for (size_t i = 0 ; i < fit_driver.transforms.size() ; ++i)
+            fit_driver.set_transform(i, make_transform(bounds[i], log_params));
+    }
+
+    template <typename... T>
+    void configure(Fit<T...>& fit_driver)
+    {
+        if (strategy)
+            fit_driver.use_strategy(*strategy);
+        else if (geodesic)
+            fit_driver.use_geodesic_acceleration();
+
+        fit_driver.cancellation = cancellation;
+
+        set_transforms(fit_driver);
+    }
+
+    template <typename... T>
+    void configure(Large_fit<T...>& fit_driver)
+    {
+        fit_driver.chunk_size = chunk_size;
+
+        set_transforms(fit_driver);
+    }
+
+    // Fits data on a context detached from ctx, which can run concurrently with other detached fits.
+    // free_variables returns references to the free variables of a context, in the order of get_bounds().
+    // If fitted is given, all parameters of the fitted context are copied to it.
+    template <typename builder_t, typename Free_variables, size_t P>
+    Start_result<P> detached_fit(const Time_series& input, const Time_series::value_type& data, bool observes_context, Free_variables free_variables,
+        const Start_point<P>& initial, const std::function<bool(size_t, double)>& stop, const Strategy* fit_strategy = nullptr,
+        const ICS_result* kernels = nullptr, Context* fitted_parameters = nullptr)
+    {
+        auto result = build_detached_result<builder_t>(input.get_time_range(), observes_context, std::nullopt, kernels);
+
+        use_emulator(result);
+
+        auto variables = free_variables(*result.context_);
+        auto fit_driver = std::apply([](auto&... variable) { return Fit(variable...); }, variables);
+
+        if (decouple and separable)
+            fit_driver.eliminate_linear_scale(result.context_->G_e);
+
+        configure(fit_driver);
+
+        if (fit_strategy)
+            fit_driver.use_strategy(*fit_strategy);
+
+        fit_driver.callback_func = nullptr;
+        fit_driver.stop = stop;
+
+        std::apply([&initial](auto&... variable) { size_t i{0}; ((variable = initial[i++]), ...); }, variables);
+
+        solve(fit_driver, data, result);
+
+        Start_result<P> fitted{initial, {}, fit_driver.cost, fit_driver.stopped, fit_driver.converged};
+        std::apply([&fitted](auto&... variable) { size_t i{0}; ((fitted.solution[i++] = variable), ...); }, variables);
+
+        if (fitted_parameters)
+            copy_parameters(*result.context_, *fitted_parameters);
+
+        return fitted;
+    }
+
+    // Refits data resampled around the fitted model of result, every replicate starts at the fitted parameters.
+    // Writes the fitted parameters and cost of every replicate to bootstrap_<output>, and logs percentile intervals.
+    template <typename builder_t, typename Free_variables>
+    void bootstrap(const Time_series& input, bool observes_context, const ICS_result& result, Free_variables free_variables)
+    {
+        constexpr size_t P = std::tuple_size_v<decltype(free_variables(*ctx))>;
+
+        Start_point<P> solution;
+        std::apply([&solution](auto&... variable) { size_t i{0}; ((solution[i++] = variable), ...); }, free_variables(*result.context_));
+
+        auto fit_replicate = [&](const Time_series::value_type& resampled) {
+            return detached_fit<builder_t>(input, resampled, observes_context, free_variables, solution, {}, nullptr, &result);
+        };
+
+        const auto results = run_bootstrap<P>(input.get_values(), result.get_values(), replicates, resampling, block_size, fit_replicate);
+
+        const auto finished = std::count_if(results.begin(), results.end(), replicate_finished<P>);
+
+        BOOST_LOG_TRIVIAL(info) << "Bootstrap: " << finished << " of " << results.size() << " replicates finished.";
+
+        // The fit itself still returns its best-so-far result
+        if (finished == 0 and cancellation and cancellation->cancelled())
+        {
+            BOOST_LOG_TRIVIAL(warning) << "Time budget ran out before any bootstrap replicate finished, skipping the intervals.";
+            return;
+        }
+
+        if (finished == 0)
+        {
+            throw std::runtime_error("None of the bootstrap replicates finished.");
+        }
+
+        const auto intervals = bootstrap_intervals(results, confidence);
+
+        for (size_t i = 0 ; i < P ; ++i)
+        {
+            BOOST_LOG_TRIVIAL(info) << "Parameter " << i << ": " << solution[i] << ", median " << intervals[i].median
+                << ", " << 100.0*confidence << "% interval [" << intervals[i].lower << ", " << intervals[i].upper << "]";
+        }
+
+        const auto path = writer.get_path().parent_path() / ("bootstrap_" + writer.get_path().filename().string());
+        std::ofstream file(path);
+
+        file << "# bootstrap replicates, " << (resampling == Resampling::BLOCKS ? "block" : "residual") << " resampling\n";
+        file << "# parameters 0.." << P-1 << ", cost\n";
+
+        for (const auto& replicate : results)
+        {
+            if (not replicate_finished(replicate))
+                continue;
+
+            for (const double value : replicate.solution)
+                file << value << ' ';
+
+            file << replicate.cost << '\n';
+        }
+    }
+
+    // Multistart and portfolio searches, both leave their solution in ctx. It is the initial guess of the final fit,
+    // except for a portfolio winner fit on the exact model, which is the final fit (see adopt_portfolio_fit).
+    template <typename builder_t, typename Free_variables>
+    void global_search(const Time_series& input, bool observes_context, Free_variables free_variables)
+    {
+        constexpr size_t P = std::tuple_size_v<decltype(free_variables(*ctx))>;
+
+        const auto data = input.get_values();
+
+        // Every start and strategy fits with the same spectrum, so their costs compare, and so does the final fit's
+        search_kernels = std::make_shared<const ICS_result>(build_detached_result<builder_t>(input.get_time_range(), observes_context));
+
+        if (starts > 0)
+        {
+            const auto all_bounds = get_bounds();
+            std::array<Bounds, P> bounds;
+            std::copy_n(all_bounds.begin(), P, bounds.begin());
+
+            auto fit_start = [&](const Start_point<P>& initial, const std::function<bool(size_t, double)>& stop) {
+                return detached_fit<builder_t>(input, data, observes_context, free_variables, initial, stop, nullptr, search_kernels.get());
+            };
+
+            const auto results = run_multistart(sample_starts(bounds, starts, sampling), fit_start);
+            const auto minima = cluster_minima(results);
+
+            const auto pruned = std::count_if(results.begin(), results.end(), [](const auto& r) { return r.pruned; });
+
+            BOOST_LOG_TRIVIAL(info) << "Multistart: " << results.size() << " starts, " << pruned << " pruned, " << minima.size() << " distinct minima.";
+
+            for (size_t m = 0 ; m < minima.size() ; ++m)
+            {
+                std::stringstream out;
+
+                out << "Minimum " << m << ": cost " << minima[m].cost << ", starts " << minima[m].starts;
+
+                for (size_t i = 0 ; i < P ; ++i)
+                    out << ", " << i << ": " << minima[m].solution[i];
+
+                BOOST_LOG_TRIVIAL(info) << out.str();
+            }
+
+            if (minima.empty())
+            {
+                throw std::runtime_error("None of the multistart fits finished.");
+            }
+
+            std::apply([&minima](auto&... variable) { size_t i{0}; ((variable = minima.front().solution[i++]), ...); }, free_variables(*ctx));
+        }
+
+        if (portfolio)
+        {
+            const auto strategies = default_strategies();
+            std::vector<Start_result<P>> fitted(strategies.size());
+            std::vector<Context> fitted_parameters(strategies.size());
+
+            Start_point<P> initial;
+            std::apply([&initial](auto&... variable) { size_t i{0}; ((initial[i++] = variable), ...); }, free_variables(*ctx));
+
+            auto fit_strategy = [&](size_t index, const std::function<bool(size_t, double)>& stop) {
+                fitted[index] = detached_fit<builder_t>(input, data, observes_context, free_variables, initial, stop, &strategies[index], search_kernels.get(), &fitted_parameters[index]);
+                return Strategy_outcome{fitted[index].converged, fitted[index].cost};
+            };
+
+            const size_t winner = race_strategies(strategies, fit_strategy);
+
+            strategy = strategies[winner];
+
+            // A winner fit on the emulator is only polished by the final fit
+            if (emulator)
+            {
+                std::apply([&fitted, winner](auto&... variable) { size_t i{0}; ((variable = fitted[winner].solution[i++]), ...); }, free_variables(*ctx));
+            }
+            else
+            {
+                // Also carries a G_e solved by variable projection, which isn't among the free variables
+                copy_parameters(fitted_parameters[winner], *ctx);
+                portfolio_cost = fitted[winner].cost;
+                portfolio_converged = fitted[winner].converged;
+            }
+        }
+    }
+
+    // Evaluates the exact model at the Chebyshev nodes of the bounds of N_e and tau_monomer, concurrently on detached results.
+    // G(t) is linear in G_e, so the emulator holds G(t)/G_e and G_e is applied exactly when it is evaluated.
+    template <typename builder_t>
+    void build_emulator(const Time_series& input, bool observes_context)
+    {
+        const auto all_bounds = get_bounds();
+        const std::array<Bounds, 2> bounds{all_bounds[0], all_bounds[1]};
+
+        if (not bounds[0].bounded() or not bounds[1].bounded())
+        {
+            throw std::runtime_error("--surrogate requires bounds for N_e and tau_monomer.");
+        }
+
+        const size_t nodes = (surrogate_degree + 1) * (surrogate_degree + 1);
+        const size_t workers = std::min(Execution_context::get().num_threads(), nodes);
+
+        auto reference = build_detached_result<builder_t>(input.get_time_range(), observes_context);
+
+        std::vector<ICS_result> models;
+        models.reserve(workers);
+
+        for (size_t w = 0 ; w < workers ; ++w)
+        {
+            models.push_back(build_detached_result<builder_t>(input.get_time_range(), observes_context, std::nullopt, &reference));
+        }
+
+        auto sample = [&models](size_t worker, const Chebyshev_emulator<2>::Point& point, double* out) {
+            ICS_result& model = models[worker];
+            Context& context = *model.context_;
+
+            context.N_e = point[0];
+            context.tau_monomer = point[1];
+            context.apply_physics();
+            model.calculate();
+
+            std::transform(model.cbegin(), model.cend(), out, [&context](double value) { return value / context.G_e; });
+        };
+
+        BOOST_LOG_TRIVIAL(info) << "Building emulator from " << nodes << " model evaluations.";
+
+        emulator = std::make_shared<const Chebyshev_emulator<2>>(bounds, surrogate_degree, input.get_time_range()->size(), workers, sample);
+    }
+
+    // Makes result evaluate the emulator instead of the model, if there is one. Results of other sizes,
+    // like the decimated levels of a multilevel fit, keep evaluating the model.
+    void use_emulator(ICS_result& result) const
+    {
+        if (not emulator)
+            return;
+
+        result.surrogate = [emulator = emulator, size = result.get_time_range()->size()](const Context& context, Time_series::value_primitive* out) {
+            if (size != emulator->size())
+                return false;
+
+            (*emulator)({context.N_e, context.tau_monomer}, out);
+            std::transform(out, out + size, out, [&context](double value) { return context.G_e * value; });
+
+            return true;
+        };
+    }
+
+    // The final fit. A fit cancelled before its first evaluation leaves result unevaluated, the output and
+    // the bootstrap still need the curve of its parameters, so it is evaluated once.
+    template <typename... T>
+    void solve_surrogate(Fit<T...>& fit_driver, const Time_series::value_type& data, ICS_result& result)
+    {
+        if (emulator)
+            solve_with_emulator(fit_driver, data, result);
+        else
+            solve(fit_driver, data, result);
+
+        if (not std::isfinite(fit_driver.cost))
+            result.calculate();
+    }
+
+    // Fits on the emulator, then continues from its solution with the exact model
+    template <typename... T>
+    void solve_with_emulator(Fit<T...>& fit_driver, const Time_series::value_type& data, ICS_result& result)
+    {
+        // Checkpoints only hold fits of the exact model
+        auto checkpoint = std::move(fit_driver.checkpoint);
+        fit_driver.checkpoint = nullptr;
+
+        use_emulator(result);
+
+        try
+        {
+            solve(fit_driver, data, result);
+            BOOST_LOG_TRIVIAL(info) << "Emulator fit: cost " << fit_driver.cost << " after " << fit_driver.iterations << " iterations.";
+        }
+        catch (const std::exception& e)
+        {
+            BOOST_LOG_TRIVIAL(warning) << "Emulator fit failed, polishing from where it stopped: " << e.what();
+        }
+
+        result.surrogate = nullptr;
+        fit_driver.checkpoint = std::move(checkpoint);
+        // The emulator is only built for this fit, bootstrap replicates aren't polished so they fit the exact model
+        emulator.reset();
+
+        if (fit_driver.cancelled)
+        {
+            BOOST_LOG_TRIVIAL(warning) << "Time budget spent on the emulator fit, keeping its solution without exact polish.";
+            return;
+        }
+
+        solve(fit_driver, data, result);
+
+        BOOST_LOG_TRIVIAL(info) << "Exact polish: cost " << fit_driver.initial_cost << " at the emulator solution, " << fit_driver.cost << " after " << fit_driver.iterations << " iterations.";
+    }
+
+    Warm_start_key warm_start_key() const
+    {
+        return Warm_start_key{Warm_start_key::fingerprint_file(inpath, file_col), ctx->N, CR_impl, c_v, decouple};
+    }
+
+    void apply_warm_start()
+    {
+        const auto values = warm_start->lookup(warm_start_key());
+
+        if (not values)
+        {
+            BOOST_LOG_TRIVIAL(info) << "No stored fit to warm start from.";
+            return;
+        }
+
+        BOOST_LOG_TRIVIAL(info) << "Warm start from stored fits: N_e " << values->N_e << ", tau_monomer " << values->tau_monomer << ", G_e " << values->G_e;
+
+        ctx->N_e = values->N_e;
+        ctx->tau_monomer = values->tau_monomer;
+
+        // G_e is only free when decoupled, otherwise it follows from the other parameters
+        if (decouple)
+            ctx->G_e = values->G_e;
+    }
+
+    // Number of free variables of the final fit, G_e is only free when decoupled and not solved analytically
+    size_t free_variable_count() const
+    {
+        return (decouple and not separable) ? 3 : 2;
+    }
+
+    void apply_checkpoint()
+    {
+        resumed = Fit_checkpoint::load(checkpoint_path);
+
+        if (resumed->fingerprint != Warm_start_key::fingerprint_file(inpath, file_col))
+        {
+            throw std::runtime_error("Checkpoint " + checkpoint_path.string() + " belongs to a fit of other data.");
+        }
+
+        if (resumed->parameters.size() != free_variable_count())
+        {
+            throw std::runtime_error("Checkpoint " + checkpoint_path.string() + " belongs to a fit with other free variables.");
+        }
+
+        BOOST_LOG_TRIVIAL(info) << "Resuming fit after " << resumed->iterations << " iterations, cost " << resumed->cost;
+
+        ctx->N_e = resumed->parameters[0];
+        ctx->tau_monomer = resumed->parameters[1];
+
+        if (resumed->parameters.size() > 2)
+            ctx->G_e = resumed->parameters[2];
+    }
+
+    // Makes the final fit write checkpoints, and continue the iteration count of the resumed fit.
+    // Rubinstein & Colby's spectrum is fixed during a fit, it is stored once next to the checkpoint and restored on resume.
+    template <typename... T>
+    void set_checkpoints(Fit<T...>& fit_driver, ICS_result& result)
+    {
+        if (checkpoint_path.empty())
+            return;
+
+        std::filesystem::path spectrum_path;
+
+        if (auto rub = dynamic_cast<RUB_constraint_release*>(result.CR.get()))
+        {
+            if (resumed and not resumed->spectrum.empty())
+            {
+                auto spectrum = Spectrum::load(resumed->spectrum);
+                rub->set_spectrum(spectrum.seed, spectrum.realization_size, std::make_shared<const std::vector<double>>(std::move(spectrum.values)));
+                spectrum_path = resumed->spectrum;
+            }
+            else
+            {
+                spectrum_path = checkpoint_path;
+                spectrum_path += ".spectrum";
+                Spectrum{rub->get_seed(), rub->get_realization_size(), *rub->get_spectrum()}.save(spectrum_path);
+            }
+        }
+
+        if (resumed)
+            fit_driver.resumed_iterations = resumed->iterations;
+
+        fit_driver.checkpoint_interval = std::max<size_t>(checkpoint_interval, 1);
+        fit_driver.checkpoint = [path = checkpoint_path, fingerprint = Warm_start_key::fingerprint_file(inpath, file_col), spectrum_path]
+            (size_t iterations, const auto& parameters, double cost) {
+                Fit_checkpoint{fingerprint, iterations, cost, {parameters.begin(), parameters.end()}, spectrum_path}.save(path);
+            };
+    }
+
+    // Result of the final fit, with the spectrum the global searches fit with if there were any
+    template <typename builder_t>
+    ICS_result build_fit_result(const Time_series& input, bool observes_context)
+    {
+        auto result = build_result<builder_t>(input.get_time_range(), observes_context);
+
+        const auto source = search_kernels ? dynamic_cast<const RUB_constraint_release*>(search_kernels->CR.get()) : nullptr;
+
+        if (auto rub = dynamic_cast<RUB_constraint_release*>(result.CR.get()); rub and source)
+            rub->set_spectrum(source->get_seed(), source->get_realization_size(), source->get_spectrum());
+
+        return result;
+    }
+
+    // Records converged fits in the warm start store and writes the output
+    // The portfolio winner already fit result's parameters, so result is only evaluated there
+    template <typename Driver>
+    bool adopt_portfolio_fit(Driver& fit_driver, ICS_result& result)
+    {
+        if (not portfolio_cost)
+            return false;
+
+        result.calculate();
+        fit_driver.converged = portfolio_converged;
+
+        BOOST_LOG_TRIVIAL(info) << "Keeping the " << strategy->name << " fit of the portfolio, cost " << *portfolio_cost << ".";
+
+        return true;
+    }
+
+    template <typename Driver>
+    void finish(const Driver& fit_driver, const ICS_result& result)
+    {
+        if (warm_start and fit_driver.converged)
+        {
+            const Context& fitted = *result.context_;
+            warm_start->record(warm_start_key(), Warm_start_values{fitted.N_e, fitted.tau_monomer, fitted.G_e});
+        }
+
+        write_output(result);
     }
 
     void write_output(const ICS_result& result)
@@ -358,23 +1018,623 @@ struct fit : lime::command<fit>, cmd_takes_file_input, cmd_writes_output_file, r
 
     void run()
     {
+        ignore_single_precision();
+
         auto input = get_file_contents();
         bool observes_context = (CR_impl == constraint_release::impl::RUBINSTEINCOLBY) ? false : true;
 
-        if (decouple)
+        if (separable and not decouple)
         {
-            auto result = build_result<ICS_decoupled_context_builder>(input.get_time_range(), observes_context);
-            Fit fit_driver(result.context_->N_e, result.context_->tau_monomer, result.context_->G_e);
-            fit_driver.fit(input.get_values(), result, wt_pow);
-            write_output(result);
+            BOOST_LOG_TRIVIAL(warning) << "Separable fitting requires decoupling G_e and M_e, ignoring --separable.";
         }
-        else
+
+        if (large and (geodesic or separable))
+        {
+            BOOST_LOG_TRIVIAL(warning) << "Large data fitting does not support --geodesic or --separable, ignoring them.";
+            geodesic = false;
+            separable = false;
+        }
+
+        if (time_budget > 0.0 and large)
+        {
+            BOOST_LOG_TRIVIAL(warning) << "Large data fitting does not support --time-budget, ignoring it.";
+        }
+        else if (time_budget > 0.0)
+        {
+            cancellation = std::make_shared<Cancellation_token>(time_budget);
+        }
+
+        if (resume and checkpoint_path.empty())
+        {
+            throw std::runtime_error("--resume requires the checkpoint file given by --checkpoint.");
+        }
+
+        // Replicates are fit with the dense solver, whose Jacobian wouldn't fit in memory either
+        if (replicates > 0 and large)
+        {
+            BOOST_LOG_TRIVIAL(warning) << "Large data fitting does not support --bootstrap, ignoring it.";
+            replicates = 0;
+        }
+
+        if (not checkpoint_path.empty() and large)
+        {
+            BOOST_LOG_TRIVIAL(warning) << "Large data fitting does not support --checkpoint, ignoring it.";
+            checkpoint_path.clear();
+            resume = false;
+        }
+
+        // The starts are fit with the dense solver as well
+        if ((starts > 0 or portfolio) and large)
+        {
+            BOOST_LOG_TRIVIAL(warning) << "Large data fitting does not support --multistart or --portfolio, ignoring them.";
+            starts = 0;
+            portfolio = false;
+        }
+
+        if (not warm_start_path.empty())
+        {
+            warm_start.emplace(warm_start_path);
+
+            if (not resume)
+                apply_warm_start();
+        }
+
+        if (use_surrogate and (large or resume))
+        {
+            BOOST_LOG_TRIVIAL(warning) << "Surrogate fitting does not support --large or --resume, ignoring --surrogate.";
+        }
+        else if (use_surrogate)
+        {
+            if (decouple)
+                build_emulator<ICS_decoupled_context_builder>(input, observes_context);
+            else
+                build_emulator<ICS_context_builder>(input, observes_context);
+        }
+
+        // The checkpoint already holds the outcome of the initial guess searches, only the final fit continues
+        if (resume)
+        {
+            apply_checkpoint();
+            multilevel = false;
+        }
+        else if (starts > 0 or portfolio)
+        {
+            if (decouple and not separable)
+                global_search<ICS_decoupled_context_builder>(input, observes_context, [](Context& c) { return std::tie(c.N_e, c.tau_monomer, c.G_e); });
+            else if (decouple)
+                global_search<ICS_decoupled_context_builder>(input, observes_context, [](Context& c) { return std::tie(c.N_e, c.tau_monomer); });
+            else
+                global_search<ICS_context_builder>(input, observes_context, [](Context& c) { return std::tie(c.N_e, c.tau_monomer); });
+        }
+
+        if (decouple and separable)
         {
-            auto result = build_result<ICS_context_builder>(input.get_time_range(), observes_context);
+            auto result = build_fit_result<ICS_decoupled_context_builder>(input, observes_context);
             Fit fit_driver(result.context_->N_e, result.context_->tau_monomer);
-            fit_driver.fit(input.get_values(), result, wt_pow);
-            write_output(result);
+            fit_driver.eliminate_linear_scale(result.context_->G_e);
+            configure(fit_driver);
+            set_checkpoints(fit_driver, result);
+            if (not adopt_portfolio_fit(fit_driver, result))
+                solve_surrogate(fit_driver, input.get_values(), result);
+            if (replicates > 0)
+                bootstrap<ICS_decoupled_context_builder>(input, observes_context, result, [](Context& c) { return std::tie(c.N_e, c.tau_monomer); });
+            finish(fit_driver, result);
+        }
+        else if (decouple and large)
+        {
+            auto result = build_fit_result<ICS_decoupled_context_builder>(input, observes_context);
+            Large_fit fit_driver(result.context_->N_e, result.context_->tau_monomer, result.context_->G_e);
+            configure(fit_driver);
+            if (not adopt_portfolio_fit(fit_driver, result))
+                solve(fit_driver, input.get_values(), result);
+            finish(fit_driver, result);
+        }
+        else if (decouple)
+        {
+            auto result = build_fit_result<ICS_decoupled_context_builder>(input, observes_context);
+            Fit fit_driver(result.context_->N_e, result.context_->tau_monomer, result.context_->G_e);
+            configure(fit_driver);
+            set_checkpoints(fit_driver, result);
+            if (not adopt_portfolio_fit(fit_driver, result))
+                solve_surrogate(fit_driver, input.get_values(), result);
+            if (replicates > 0)
+                bootstrap<ICS_decoupled_context_builder>(input, observes_context, result, [](Context& c) { return std::tie(c.N_e, c.tau_monomer, c.G_e); });
+            finish(fit_driver, result);
+        }
+        else if (large)
+        {
+            auto result = build_fit_result<ICS_context_builder>(input, observes_context);
+            Large_fit fit_driver(result.context_->N_e, result.context_->tau_monomer);
+            configure(fit_driver);
+            if (not adopt_portfolio_fit(fit_driver, result))
+                solve(fit_driver, input.get_values(), result);
+            finish(fit_driver, result);
+        }
+        else
+        {
+            auto result = build_fit_result<ICS_context_builder>(input, observes_context);
+            Fit fit_driver(result.context_->N_e, result.context_->tau_monomer);
+            configure(fit_driver);
+            set_checkpoints(fit_driver, result);
+            if (not adopt_portfolio_fit(fit_driver, result))
+                solve_surrogate(fit_driver, input.get_values(), result);
+            if (replicates > 0)
+                bootstrap<ICS_context_builder>(input, observes_context, result, [](Context& c) { return std::tie(c.N_e, c.tau_monomer); });
+            finish(fit_driver, result);
+        }
+    }
+};
+
+struct selectcr : lime::command<selectcr>, cmd_takes_file_input, cmd_writes_output_file, result_cmd, cmd_can_output_terms, cmd_has_parameter_bounds
+{
+    double wt_pow;
+    bool decouple;
+    bool log_params;
+
+    struct Candidate
+    {
+        constraint_release::impl impl;
+        std::unique_ptr<ICS_result> result;
+        double cost;
+        double residual_norm;
+        bool converged;
+        // Empty unless the fit failed
+        std::string error;
+    };
+
+    selectcr() : cmd_can_output_terms(cmd_writes_output_file::writer), wt_pow{0.0}, decouple{false}, log_params{false}
+    {}
+
+    static const char* help()
+    {
+        return "Fit existing G(t) data with every constraint release model and compare them by information criteria";
+    }
+
+    template<class F>
+    void parse(F f)
+    {
+        cmd_takes_file_input::parse(f);
+        result_cmd::parse(f);
+        cmd_writes_output_file::parse(f);
+        cmd_can_output_terms::parse(f);
+        cmd_has_parameter_bounds::parse(f);
+        f(wt_pow,   "-w", "--weightpower",         args::help("Set power for the weighting factor 1/(x^wt)") );
+        f(decouple, "--decouple",                  args::help("Decouple G_e and M_e"), args::set(true));
+        f(ctx->G_e, "-g", "--entanglementmodulus", args::help("Set initial guess for entanglement modulus, only used when decouple=true") );
+        f(log_params, "--logparams",               args::help("Fit the logarithm of unbounded free variables, which keeps them positive"), args::set(true));
+    }
+
+    // Fits all registered constraint release models concurrently, each on its own detached result, and writes the
+    // output of the model with the lowest AIC. All models share the free variables, so AIC and BIC rank them alike;
+    // both are reported for comparison with fits elsewhere.
+    template <typename builder_t, typename Free_variables>
+    void select(const Time_series& input, Free_variables free_variables)
+    {
+        const auto data = input.get_values();
+        const auto impls = constraint_release::Factory_observed::keys();
+        const auto bounds = get_bounds();
+        constexpr size_t P = std::tuple_size_v<decltype(free_variables(*ctx))>;
+
+        std::vector<Candidate> candidates(impls.size());
+        std::vector<size_t> indices(impls.size());
+        std::iota(indices.begin(), indices.end(), 0);
+
+        with_task_policy([&](const auto& policy) {
+            std::for_each(policy, indices.begin(), indices.end(), [&](size_t i) {
+                Candidate& candidate = candidates[i];
+                candidate.impl = impls[i];
+
+                // Exceptions can't leave a parallel algorithm
+                try
+                {
+                    const bool observes_context = (candidate.impl == constraint_release::impl::RUBINSTEINCOLBY) ? false : true;
+
+                    candidate.result = std::make_unique<ICS_result>(build_detached_result<builder_t>(input.get_time_range(), observes_context, candidate.impl));
+
+                    auto fit_driver = std::apply([](auto&... variable) { return Fit(variable...); }, free_variables(*candidate.result->context_));
+                    fit_driver.callback_func = nullptr;
+
+                    for (size_t v = 0 ; v < P ; ++v)
+                        fit_driver.set_transform(v, make_transform(bounds[v], log_params));
+
+                    fit_driver.fit(data, *candidate.result, wt_pow);
+
+                    candidate.cost = fit_driver.cost;
+                    candidate.converged = fit_driver.converged;
+
+                    double squares{0.0};
+                    auto value = candidate.result->cbegin();
+
+                    for (size_t j = 0 ; j < data.size() ; ++j, ++value)
+                        squares += square((data[j] - *value) / data[j]);
+
+                    candidate.residual_norm = std::sqrt(squares);
+                }
+                catch (const std::exception& e)
+                {
+                    candidate.error = e.what();
+                }
+            });
+        });
+
+        const Candidate* best{nullptr};
+        double best_aic{std::numeric_limits<double>::infinity()};
+
+        for (const auto& candidate : candidates)
+        {
+            if (not candidate.error.empty())
+            {
+                BOOST_LOG_TRIVIAL(warning) << constraint_release::name(candidate.impl) << ": fit failed: " << candidate.error;
+                continue;
+            }
+
+            const double aic = AIC(candidate.cost, data.size(), P);
+            const double bic = BIC(candidate.cost, data.size(), P);
+
+            BOOST_LOG_TRIVIAL(info) << constraint_release::name(candidate.impl) << ": cost " << candidate.cost << ", |f| " << candidate.residual_norm
+                << ", AIC " << aic << ", BIC " << bic << (candidate.converged ? "" : " (not converged)");
+
+            if (aic < best_aic)
+            {
+                best_aic = aic;
+                best = &candidate;
+            }
+        }
+
+        if (not best)
+        {
+            throw std::runtime_error("None of the constraint release models could be fitted.");
         }
+
+        BOOST_LOG_TRIVIAL(info) << "Best model: " << constraint_release::name(best->impl);
+
+        auto best_view = builder_t(system, best->result->context_).context_view();
+
+        BOOST_LOG_TRIVIAL(info) << *best_view << "cv: " << best->result->CR->c_v_;
+        writer << *best_view << *best->result;
+        output_terms(*best->result);
+    }
+
+    void run()
+    {
+        ignore_single_precision();
+
+        auto input = get_file_contents();
+
+        if (decouple)
+            select<ICS_decoupled_context_builder>(input, [](Context& c) { return std::tie(c.N_e, c.tau_monomer, c.G_e); });
+        else
+            select<ICS_context_builder>(input, [](Context& c) { return std::tie(c.N_e, c.tau_monomer); });
+    }
+};
+
+struct jointfit : lime::command<jointfit>, cmd_writes_output_file, result_cmd, cmd_has_parameter_bounds
+{
+    std::vector<std::filesystem::path> inpaths;
+    std::vector<double> lengths;
+    size_t file_col;
+    double wt_pow;
+    bool decouple;
+    bool log_params;
+
+    jointfit() : inpaths{}, lengths{}, file_col{1}, wt_pow{0.0}, decouple{false}, log_params{false}
+    {}
+
+    static const char* help()
+    {
+        return "Fit G(t) data of several chain lengths of the same polymer, with N_e and tau_monomer shared between them";
+    }
+
+    // The chain length differs between the data sets, so unlike other commands N is not a single flag
+    template<class F>
+    void parse(F f)
+    {
+        f(inpaths,                                  args::help("Paths to the data files"));
+        f(file_col, "-C", "--column",               args::help("Column to select from the input files. Defaults to 1."));
+        f(lengths,  "--lengths",                    args::help("Chain length of every data file, in the same order"), args::required());
+        f(system->rho,       "-r", "--density",                  args::help("Density"),                                      args::required());
+        f(system->T,         "-T", "--temperature",              args::help("Temperature")                                                   );
+        f(ctx->N_e,          "-n", "--monomersperentanglement",  args::help("Initial guess of the number of monomers per entanglement"), args::required());
+        f(ctx->tau_monomer,  "-m", "--monomerrelaxationtime",    args::help("Initial guess of the monomer relaxation time"), args::required());
+        f(c_v,               "-c", "--crparameter",              args::help("Constraint release parameter"),                 args::required());
+        f(CR_impl, "--rub", args::help("Use Rubinstein&Colby constraint release (mutually exclusive with --doublerep)"), args::exclude("--doublerep"), args::set(constraint_release::impl::RUBINSTEINCOLBY));
+        f(CR_impl, "--doublerep", args::help("Use double reptation for constraint release"), args::set(constraint_release::impl::DOUBLEREPTATION));
+        cmd_writes_output_file::parse(f);
+        cmd_has_parameter_bounds::parse(f);
+        f(wt_pow,   "-w", "--weightpower",         args::help("Set power for the weighting factor 1/(x^wt)") );
+        f(decouple, "--decouple",                  args::help("Decouple G_e and M_e, G_e is shared as well"), args::set(true));
+        f(ctx->G_e, "-g", "--entanglementmodulus", args::help("Set initial guess for entanglement modulus, only used when decouple=true") );
+        f(log_params, "--logparams",               args::help("Fit the logarithm of unbounded free variables, which keeps them positive"), args::set(true));
+    }
+
+    // Writes the fitted G(t) of every data set to N<length>_<output>
+    template <typename builder_t, size_t P>
+    void joint(const std::vector<Time_series>& inputs)
+    {
+        const bool observes_context = (CR_impl == constraint_release::impl::RUBINSTEINCOLBY) ? false : true;
+
+        std::vector<Time_series::value_type> data;
+        std::vector<ICS_result> results;
+        results.reserve(inputs.size());
+
+        for (size_t d = 0 ; d < inputs.size() ; ++d)
+        {
+            ctx->N = lengths[d];
+            data.push_back(inputs[d].get_values());
+            results.push_back(build_detached_result<builder_t>(inputs[d].get_time_range(), observes_context));
+        }
+
+        std::vector<typename Joint_fit<P>::Dataset> datasets;
+
+        for (size_t d = 0 ; d < inputs.size() ; ++d)
+            datasets.push_back({&data[d], &results[d]});
+
+        Joint_fit<P> fit_driver([](const auto& parameters, Context& context) {
+            context.N_e = parameters[0];
+            context.tau_monomer = parameters[1];
+
+            if constexpr (P > 2)
+                context.G_e = parameters[2];
+        });
+
+        const auto bounds = get_bounds();
+
+        for (size_t i = 0 ; i < P ; ++i)
+            fit_driver.set_transform(i, make_transform(bounds[i], log_params));
+
+        typename Joint_fit<P>::Parameters parameters;
+        const std::array<double, 3> guess{ctx->N_e, ctx->tau_monomer, ctx->G_e};
+        std::copy_n(guess.begin(), P, parameters.begin());
+
+        fit_driver.fit(datasets, parameters, wt_pow);
+
+        const auto original_filename = writer.get_path().filename().string();
+
+        for (size_t d = 0 ; d < results.size() ; ++d)
+        {
+            auto result_view = builder_t(system, results[d].context_).context_view();
+
+            BOOST_LOG_TRIVIAL(info) << *result_view << "cv: " << results[d].CR->c_v_;
+
+            std::stringstream filename;
+            filename << "N" << lengths[d] << "_" << original_filename;
+
+            writer.set_filename(filename.str());
+            writer << *result_view << results[d];
+        }
+    }
+
+    void run()
+    {
+        ignore_single_precision();
+
+        if (inpaths.empty() or inpaths.size() != lengths.size())
+        {
+            throw std::runtime_error("Joint fitting needs one chain length per data file.");
+        }
+
+        std::vector<Time_series> inputs;
+
+        for (const auto& path : inpaths)
+            inputs.push_back(File_reader::get_file_contents(path, file_col));
+
+        if (decouple)
+            joint<ICS_decoupled_context_builder, 3>(inputs);
+        else
+            joint<ICS_context_builder, 2>(inputs);
+    }
+};
+
+struct sample : lime::command<sample>, cmd_takes_file_input, cmd_writes_output_file, result_cmd, cmd_has_parameter_bounds
+{
+    bool decouple;
+    Bounds c_v_bounds;
+    size_t walkers;
+    size_t steps;
+    size_t temperatures;
+    double ladder;
+    double sigma;
+    unsigned int seed;
+
+    sample() : decouple{false}, c_v_bounds{}, walkers{32}, steps{1000}, temperatures{1}, ladder{std::sqrt(2.0)}, sigma{0.05}, seed{0}
+    {}
+
+    static const char* help()
+    {
+        return "Sample the posterior distribution of the model parameters given existing G(t) data";
+    }
+
+    template<class F>
+    void parse(F f)
+    {
+        cmd_takes_file_input::parse(f);
+        result_cmd::parse(f);
+        cmd_writes_output_file::parse(f);
+        cmd_has_parameter_bounds::parse(f);
+        f(decouple, "--decouple",                  args::help("Decouple G_e and M_e"), args::set(true));
+        f(ctx->G_e, "-g", "--entanglementmodulus", args::help("Set initial guess for entanglement modulus, only used when decouple=true") );
+        f(c_v_bounds, "--cvbounds",                args::help("Bounds for the constraint release parameter, as lower:upper"));
+        f(walkers,  "--walkers",                   args::help("Number of walkers per temperature, even and at least twice the number of parameters. Defaults to 32"));
+        f(steps,    "--steps",                     args::help("Number of ensemble steps, the first half is discarded as burn-in in the summary. Defaults to 1000"));
+        f(temperatures, "--temperatures",          args::help("Number of temperatures for parallel tempering, defaults to 1"));
+        f(ladder,   "--ladder",                    args::help("Ratio between neighbouring temperatures, defaults to sqrt(2)"));
+        f(sigma,    "--sigma",                     args::help("Relative noise of the data points, defaults to 0.05"));
+        f(seed,     "--seed",                      args::help("Seed of the random number generators"));
+    }
+
+    // Walkers move in the logarithm of N_e, tau_monomer, c_v and, when decoupled, G_e. The prior is uniform in the
+    // logarithms within the bounds, the likelihood Gaussian in the relative residuals. Every walker at every
+    // temperature evaluates on its own detached result, all sharing the constraint release kernels of the first.
+    template <typename builder_t, size_t P>
+    void run_sampler(const Time_series& input)
+    {
+        using Point = typename Tempered_ensemble<P>::Point;
+
+        static const std::array<std::string, 4> names{"N_e", "tau_monomer", "c_v", "G_e"};
+
+        const auto parameter_bounds = get_bounds();
+        const std::array<Bounds, 4> all_bounds{parameter_bounds[0], parameter_bounds[1], c_v_bounds, parameter_bounds[2]};
+        const std::array<double, 4> guess{ctx->N_e, ctx->tau_monomer, c_v, ctx->G_e};
+
+        Point lower, upper, initial;
+
+        for (size_t i = 0 ; i < P ; ++i)
+        {
+            if (not all_bounds[i].bounded() or all_bounds[i].lower <= 0.0)
+            {
+                throw std::runtime_error("Sampling requires positive, finite bounds for " + names[i] + ".");
+            }
+
+            if (not all_bounds[i].contains(guess[i]))
+            {
+                throw std::runtime_error("The initial guess of " + names[i] + " lies outside of its bounds.");
+            }
+
+            lower[i] = std::log(all_bounds[i].lower);
+            upper[i] = std::log(all_bounds[i].upper);
+            initial[i] = std::log(guess[i]);
+        }
+
+        const bool observes_context = (CR_impl == constraint_release::impl::RUBINSTEINCOLBY) ? false : true;
+        const auto data = input.get_values();
+
+        auto reference = build_detached_result<builder_t>(input.get_time_range(), observes_context);
+
+        std::vector<ICS_result> models;
+        models.reserve(walkers * temperatures);
+
+        // All slots read the spectrum of the reference instead of each drawing and holding one
+        for (size_t s = 0 ; s < walkers * temperatures ; ++s)
+        {
+            models.push_back(build_detached_result<builder_t>(input.get_time_range(), observes_context, std::nullopt, &reference));
+        }
+
+        auto log_prior = [lower, upper](const Point& x) {
+            for (size_t i = 0 ; i < P ; ++i)
+            {
+                if (x[i] < lower[i] or x[i] > upper[i])
+                    return -std::numeric_limits<double>::infinity();
+            }
+
+            return 0.0;
+        };
+
+        auto log_likelihood = [this, &models, &data](size_t slot, const Point& x) {
+            ICS_result& model = models[slot];
+            Context& context = *model.context_;
+
+            context.N_e = std::exp(x[0]);
+            context.tau_monomer = std::exp(x[1]);
+            model.CR->c_v_ = std::exp(x[2]);
+
+            if constexpr (P > 3)
+                context.G_e = std::exp(x[3]);
+
+            context.apply_physics();
+            model.calculate();
+
+            double chisq{0.0};
+            auto value = model.cbegin();
+
+            for (size_t j = 0 ; j < data.size() ; ++j, ++value)
+            {
+                const double residual = (data[j] - *value) / (sigma * data[j]);
+                chisq += residual * residual;
+            }
+
+            return -0.5 * chisq;
+        };
+
+        // Walkers start in a small ball around the initial guess
+        std::mt19937 generator(seed);
+        std::normal_distribution<double> ball(0.0, 1e-2);
+        std::vector<Point> start(walkers);
+
+        for (auto& point : start)
+        {
+            for (size_t i = 0 ; i < P ; ++i)
+            {
+                do
+                {
+                    point[i] = initial[i] + ball(generator);
+                }
+                while (point[i] < lower[i] or point[i] > upper[i]);
+            }
+        }
+
+        Tempered_ensemble<P> ensemble(start, temperatures, ladder, log_prior, log_likelihood, seed);
+
+        auto& chain = writer.get_stream();
+
+        chain << "# step walker";
+
+        for (size_t i = 0 ; i < P ; ++i)
+            chain << ' ' << names[i];
+
+        chain << " log_posterior\n";
+
+        std::array<std::vector<double>, P> samples;
+
+        for (size_t step = 0 ; step < steps ; ++step)
+        {
+            ensemble.step();
+
+            for (size_t k = 0 ; k < walkers ; ++k)
+            {
+                const auto& x = ensemble.position(k);
+
+                chain << step << ' ' << k;
+
+                for (size_t i = 0 ; i < P ; ++i)
+                {
+                    chain << ' ' << std::exp(x[i]);
+
+                    if (step >= steps / 2)
+                        samples[i].push_back(std::exp(x[i]));
+                }
+
+                chain << ' ' << ensemble.log_posterior(k) << '\n';
+            }
+
+            // Streamed, so an interrupted run keeps its chain
+            chain.flush();
+
+            if ((step + 1) % 100 == 0)
+            {
+                BOOST_LOG_TRIVIAL(info) << "Step " << step + 1 << ", acceptance fraction " << ensemble.acceptance_fraction();
+            }
+        }
+
+        BOOST_LOG_TRIVIAL(info) << "Acceptance fraction " << ensemble.acceptance_fraction();
+
+        if (temperatures > 1)
+        {
+            BOOST_LOG_TRIVIAL(info) << "Temperature swap fraction " << ensemble.swap_fraction();
+        }
+
+        if (samples.front().empty())
+        {
+            return;
+        }
+
+        for (size_t i = 0 ; i < P ; ++i)
+        {
+            const auto interval = percentile_interval(samples[i], 0.6827);
+
+            BOOST_LOG_TRIVIAL(info) << names[i] << ": median " << interval.median << ", 68% interval [" << interval.lower << ", " << interval.upper << "]";
+        }
+    }
+
+    void run()
+    {
+        ignore_single_precision();
+
+        auto input = get_file_contents();
+
+        if (decouple)
+            run_sampler<ICS_decoupled_context_builder, 4>(input);
+        else
+            run_sampler<ICS_context_builder, 3>(input);
     }
 };
 
@@ -13,21 +13,6 @@
  * 
  */
 
-Async_except* Async_except::inst = nullptr;
-
-Async_except::Async_except()
-{}
-
-Async_except* Async_except::get()
-{
-    if (!inst)
-    {
-        inst = new Async_except;
-    }
-
-    return inst;
-}
-
 void lime_log::print_exception(const std::exception& e, int level)
 {
     BOOST_LOG_TRIVIAL(fatal) << std::string(level, ' ') << "exception: " << e.what();
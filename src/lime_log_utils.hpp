@@ -22,20 +22,6 @@
 #include <stdexcept>
 #include <functional>
 
-// NOT THREAD SAFE, meant for parallel std::algorithms only
-struct Async_except
-{
-    private:
-        static Async_except* inst;
-
-    public:
-        static Async_except* get();
-        std::exception_ptr ep;
-
-    protected:
-        Async_except();
-};
-
 template<typename T, typename F>
 void
 info_or_warn(const std::string& description, const T& var, F pred)
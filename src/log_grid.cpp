@@ -0,0 +1,120 @@
+/*
+ *  This file is part of Lime, a tool for the application of Likhtman & McLiesh' model for polymer dyanmics.
+ *
+ *  Copyright © 2020 Daniel Emmery (CNRS)
+ *
+ *  File contents:
+ *
+ *  Logarithmically uniform time grids, computing their time points on demand
+ *
+ *  GPL 3.0 License
+ *
+ */
+
+#include "log_grid.hpp"
+#include "utilities.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+
+Log_grid
+Log_grid::exponential(primitive base, primitive max, primitive norm)
+{
+    if (std::abs(base - 1.0) < std::numeric_limits<double>::epsilon())
+    {
+        throw std::runtime_error("Using 1.0 as a base for a logarithmic scale will result in an empty time range.");
+    }
+
+    return Log_grid{base, static_cast<size_t>(log_with_base<primitive>(base, max)), 0, norm};
+}
+
+std::optional<Log_grid>
+Log_grid::detect(const Time_range::base& time, primitive tolerance)
+{
+    if (time.size() < 2 or time.front() <= 0.0 or time[1] <= time.front())
+    {
+        return std::nullopt;
+    }
+
+    const primitive base = time[1] / time.front();
+    const Log_grid grid{base, time.size(), 0, 1.0 / time.front()};
+
+    for (size_t i = 0 ; i < time.size() ; ++i)
+    {
+        if (std::abs(grid[i] - time[i]) > tolerance * time[i])
+        {
+            return std::nullopt;
+        }
+    }
+
+    return grid;
+}
+
+size_t
+Log_grid::index_of(primitive t) const
+{
+    if (count == 0)
+    {
+        throw std::runtime_error("Tried to look up a time in an empty grid.");
+    }
+
+    if (not (t > (*this)[0]))
+    {
+        return 0;
+    }
+
+    const primitive exponent = std::log(t * norm) / std::log(base) - static_cast<primitive>(offset);
+    size_t index = static_cast<size_t>(std::clamp<primitive>(std::floor(exponent), 0.0, static_cast<primitive>(count - 1)));
+
+    // The logarithm may round across a point
+    while (index + 1 < count and (*this)[index + 1] <= t)
+    {
+        ++index;
+    }
+
+    while (index > 0 and (*this)[index] > t)
+    {
+        --index;
+    }
+
+    return index;
+}
+
+Log_grid
+Log_grid::slice(size_t first, size_t last) const
+{
+    if (first > last or last > count)
+    {
+        throw std::out_of_range("Tried to slice a grid outside of its points.");
+    }
+
+    return Log_grid{base, last - first, offset + static_cast<long>(first), norm};
+}
+
+Time_range::type
+Log_grid::materialize() const
+{
+    // Only grids starting at base^0 are described by base and normalization
+    if (offset == 0)
+    {
+        return Time_grid_registry::get().intern(chunk(0, count), base, std::numeric_limits<primitive>::quiet_NaN(), norm);
+    }
+
+    return Time_grid_registry::get().intern(chunk(0, count));
+}
+
+Time_range::type
+Log_grid::chunk(size_t first, size_t last) const
+{
+    const auto points = slice(first, last);
+
+    auto time = Time_range::construct(points.size());
+
+    for (size_t i = 0 ; i < points.size() ; ++i)
+    {
+        (*time)[i] = points[i];
+    }
+
+    return time;
+}
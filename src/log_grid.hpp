@@ -0,0 +1,63 @@
+#pragma once
+
+/*
+ *  This file is part of Lime, a tool for the application of Likhtman & McLiesh' model for polymer dyanmics.
+ *
+ *  Copyright © 2020 Daniel Emmery (CNRS)
+ *
+ *  File contents:
+ *
+ *  Logarithmically uniform time grids, computing their time points on demand
+ *
+ *  GPL 3.0 License
+ *
+ */
+
+#include "time_series.hpp"
+
+#include <cmath>
+#include <optional>
+
+// Point i is base^(offset + i) / norm, which is bitwise equal to the points of Time_range::generate_exponential.
+// Finding the point nearest to a time costs a logarithm instead of a search, and long grids can be evaluated in
+// chunks without ever storing all of their points.
+struct Log_grid
+{
+    using primitive = Time_range::primitive;
+
+    primitive base;
+    size_t count;
+    // Exponent of the first point
+    long offset;
+    primitive norm;
+
+    // The grid of Time_range::generate_normalized_exponential(base, max, norm)
+    static Log_grid exponential(primitive base, primitive max, primitive norm = 1.0);
+
+    // The grid matching time, if its points are log uniform to within tolerance relative to each point
+    static std::optional<Log_grid> detect(const Time_range::base& time, primitive tolerance = 1e-9);
+
+    primitive
+    operator[](size_t index) const
+    {
+        return std::pow(base, static_cast<primitive>(offset + static_cast<long>(index))) / norm;
+    }
+
+    size_t
+    size() const
+    {
+        return count;
+    }
+
+    // Index of the last point at or before t, clamped onto the grid
+    size_t index_of(primitive t) const;
+
+    // Points [first, last) as a grid of their own
+    Log_grid slice(size_t first, size_t last) const;
+
+    // All points, interned like the grids of Time_range::generate_exponential
+    Time_range::type materialize() const;
+
+    // Points [first, last), not interned, meant to be evaluated and dropped
+    Time_range::type chunk(size_t first, size_t last) const;
+};
@@ -15,7 +15,7 @@
 
 #include "utilities.hpp"
 #include "time_series.hpp"
-#include "parallel_policy.hpp"
+#include "autotune.hpp"
 
 struct Longitudinal_motion : private Summation<double, double>
 {
@@ -38,7 +38,8 @@ struct Longitudinal_motion : private Summation<double, double>
     {
         Time_series res{time_range};
 
-        std::transform(exec_policy, time_range->begin(), time_range->end(), res.begin(), *this);
+        static const Kernel_id kernel{"longitudinal_motion"};
+        tuned_transform(kernel, time_range->begin(), time_range->end(), res.begin(), *this);
 
         return res;
     }
@@ -0,0 +1,100 @@
+/*
+ *  This file is part of Lime, a tool for the application of Likhtman & McLiesh' model for polymer dyanmics.
+ *
+ *  Copyright © 2020 Daniel Emmery (CNRS)
+ *
+ *  File contents:
+ *
+ *  Configuration of STL parallel algorithms
+ *
+ *  GPL 3.0 License
+ *
+ */
+
+#include "parallel_policy.hpp"
+
+#include <algorithm>
+#include <thread>
+
+#ifdef RUN_PARALLEL
+    // Still a preview in TBB 2018
+    #define TBB_PREVIEW_GLOBAL_CONTROL 1
+    #include <tbb/global_control.h>
+#endif
+
+namespace
+{
+    // Below this many points, evaluating a grid in parallel is slower than in sequence
+    constexpr size_t default_sequential_threshold = 128;
+}
+
+#ifdef RUN_PARALLEL
+struct Execution_context::Thread_limit
+{
+    tbb::global_control control;
+
+    explicit Thread_limit(size_t threads)
+    :   control{tbb::global_control::max_allowed_parallelism, threads}
+    {}
+};
+#else
+struct Execution_context::Thread_limit
+{
+    explicit Thread_limit(size_t)
+    {}
+};
+#endif
+
+Execution_context::Execution_context()
+:   threads_{0}, threshold_{default_sequential_threshold}
+{}
+
+Execution_context::~Execution_context() = default;
+
+Execution_context&
+Execution_context::get()
+{
+    static Execution_context context;
+    return context;
+}
+
+void
+Execution_context::set_num_threads(size_t threads)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    // The lowest of all active limits applies, so the old one is lifted first
+    limit_.reset();
+
+    if (threads > 0)
+    {
+        limit_ = std::make_unique<Thread_limit>(threads);
+    }
+
+    threads_.store(threads);
+}
+
+size_t
+Execution_context::num_threads() const
+{
+    const size_t threads = threads_.load();
+
+    if (threads > 0)
+    {
+        return threads;
+    }
+
+    return std::max<size_t>(1, std::thread::hardware_concurrency());
+}
+
+void
+Execution_context::set_sequential_threshold(size_t size)
+{
+    threshold_.store(size);
+}
+
+size_t
+Execution_context::sequential_threshold() const
+{
+    return threshold_.load();
+}
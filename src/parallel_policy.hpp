@@ -14,9 +14,88 @@
  */
 
 #include <execution>
+#include <atomic>
+#include <cstddef>
+#include <limits>
+#include <memory>
+#include <mutex>
 
 #ifdef RUN_PARALLEL
     inline constexpr auto exec_policy = std::execution::par_unseq;
+    // Element functions that catch exceptions, take locks or use atomics, like those guarded by an Error_channel,
+    // may not be interleaved on one thread, which par_unseq allows
+    inline constexpr auto sync_exec_policy = std::execution::par;
 #else
     inline constexpr auto exec_policy = std::execution::seq;
+    inline constexpr auto sync_exec_policy = std::execution::seq;
 #endif
+
+// exec_policy only says whether algorithms may run in parallel. This bounds the threads they use at runtime, so
+// several processes can share a node, and keeps short grids sequential, where starting tasks costs more than it saves.
+class Execution_context
+{
+    public:
+        static Execution_context& get();
+
+        // 0 uses all hardware threads
+        void set_num_threads(size_t threads);
+        size_t num_threads() const;
+
+        void set_sequential_threshold(size_t size);
+        size_t sequential_threshold() const;
+
+        // Whether an algorithm over size elements is worth running in parallel
+        bool
+        parallel(size_t size) const
+        {
+            return threads_.load(std::memory_order_relaxed) != 1 and size >= threshold_.load(std::memory_order_relaxed);
+        }
+
+        ~Execution_context();
+
+    private:
+        Execution_context();
+
+        // Holds the scheduler's limit, which lasts as long as it does
+        struct Thread_limit;
+
+        std::mutex mutex_;
+        std::unique_ptr<Thread_limit> limit_;
+        std::atomic<size_t> threads_;
+        std::atomic<size_t> threshold_;
+};
+
+// Calls func with exec_policy, or with the sequential policy if size elements are too few to run in parallel
+template <typename F>
+decltype(auto)
+with_policy(size_t size, F&& func)
+{
+    if (Execution_context::get().parallel(size))
+    {
+        return func(exec_policy);
+    }
+
+    return func(std::execution::seq);
+}
+
+// As with_policy, with sync_exec_policy for element functions that synchronize
+template <typename F>
+decltype(auto)
+with_sync_policy(size_t size, F&& func)
+{
+    if (Execution_context::get().parallel(size))
+    {
+        return func(sync_exec_policy);
+    }
+
+    return func(std::execution::seq);
+}
+
+// For loops over a few expensive tasks, like whole fits, which run in parallel unless limited to one thread.
+// Tasks catch their exceptions and log, so they run with sync_exec_policy.
+template <typename F>
+decltype(auto)
+with_task_policy(F&& func)
+{
+    return with_sync_policy(std::numeric_limits<size_t>::max(), std::forward<F>(func));
+}
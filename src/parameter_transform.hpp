@@ -0,0 +1,196 @@
+#pragma once
+
+/*
+ *  This file is part of Lime, a tool for the application of Likhtman & McLiesh' model for polymer dyanmics.
+ *
+ *  Copyright © 2020 Daniel Emmery (CNRS)
+ *
+ *  File contents:
+ *
+ *  Transforms between the unconstrained parameter space of the solver and the model parameters
+ *
+ *  GPL 3.0 License
+ *
+ */
+
+#include "utilities.hpp"
+
+#include <gsl/gsl_matrix.h>
+#include <gsl/gsl_vector.h>
+
+#include <array>
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <istream>
+#include <ostream>
+#include <sstream>
+#include <stdexcept>
+
+struct Bounds
+{
+    double lower = -std::numeric_limits<double>::infinity();
+    double upper = std::numeric_limits<double>::infinity();
+
+    bool
+    bounded() const
+    {
+        return std::isfinite(lower) and std::isfinite(upper);
+    }
+
+    bool
+    contains(double value) const
+    {
+        return value > lower and value < upper;
+    }
+};
+
+// Reads bounds formatted as lower:upper
+inline std::istream&
+operator>> (std::istream& stream, Bounds& bounds)
+{
+    char separator{};
+
+    stream >> bounds.lower >> separator >> bounds.upper;
+
+    if (not stream or separator != ':' or not (bounds.lower < bounds.upper))
+    {
+        throw std::runtime_error("Could not read bounds, use lower:upper with lower < upper.");
+    }
+
+    return stream;
+}
+
+inline std::ostream&
+operator<< (std::ostream& stream, const Bounds& bounds)
+{
+    return stream << bounds.lower << ':' << bounds.upper;
+}
+
+struct IParameter_transform
+{
+    virtual ~IParameter_transform() = default;
+
+    // Solver (internal) value to model (external) value
+    virtual double to_external(double internal) const = 0;
+    // Model (external) value to solver (internal) value
+    virtual double to_internal(double external) const = 0;
+    // d external / d internal, used to carry Jacobians and covariances over to the model parameters
+    virtual double derivative(double internal) const = 0;
+};
+
+struct Identity_transform : public IParameter_transform
+{
+    double to_external(double internal) const override
+    {
+        return internal;
+    }
+
+    double to_internal(double external) const override
+    {
+        return external;
+    }
+
+    double derivative(double) const override
+    {
+        return 1.0;
+    }
+};
+
+// Keeps parameters strictly positive and makes steps relative
+struct Log_transform : public IParameter_transform
+{
+    double to_external(double internal) const override
+    {
+        return std::exp(internal);
+    }
+
+    double to_internal(double external) const override
+    {
+        if (not (external > 0.0))
+        {
+            std::stringstream out;
+            out << "Log transformed parameters need a positive initial guess, got " << external << ".";
+            throw std::runtime_error(out.str());
+        }
+
+        return std::log(external);
+    }
+
+    double derivative(double internal) const override
+    {
+        return std::exp(internal);
+    }
+};
+
+// Keeps parameters strictly within bounds
+struct Sigmoid_transform : public IParameter_transform
+{
+    explicit Sigmoid_transform(Bounds bounds)
+    :   bounds_{bounds}
+    {
+        if (not bounds_.bounded())
+        {
+            throw std::runtime_error("Sigmoid transform requires finite bounds.");
+        }
+    }
+
+    double to_external(double internal) const override
+    {
+        return bounds_.lower + (bounds_.upper - bounds_.lower) * sigmoid(internal);
+    }
+
+    double to_internal(double external) const override
+    {
+        if (not bounds_.contains(external))
+        {
+            std::stringstream out;
+            out << "Initial guess " << external << " is outside of bounds " << bounds_ << ".";
+            throw std::runtime_error(out.str());
+        }
+
+        return logit((external - bounds_.lower) / (bounds_.upper - bounds_.lower));
+    }
+
+    double derivative(double internal) const override
+    {
+        const double s = sigmoid(internal);
+        return (bounds_.upper - bounds_.lower) * s * (1.0 - s);
+    }
+
+  private:
+    Bounds bounds_;
+};
+
+// Bounded parameters get a sigmoid, others a log transform if requested
+inline std::shared_ptr<const IParameter_transform>
+make_transform(const Bounds& bounds, bool log_transform)
+{
+    if (bounds.bounded())
+    {
+        return std::make_shared<Sigmoid_transform>(bounds);
+    }
+    else if (log_transform)
+    {
+        return std::make_shared<Log_transform>();
+    }
+    else
+    {
+        return std::make_shared<Identity_transform>();
+    }
+}
+
+// Carries the covariance of the internal values over to the external values: C_ext = D C_int D, D = diag(d external / d internal)
+template <size_t N>
+void
+to_external_covariance(const std::array<std::shared_ptr<const IParameter_transform>, N>& transforms, const gsl_vector* x, gsl_matrix* covar)
+{
+    for (size_t i = 0 ; i < N ; ++i)
+    {
+        for (size_t j = 0 ; j < N ; ++j)
+        {
+            const double chain = transforms[i]->derivative(gsl_vector_get(x, i)) * transforms[j]->derivative(gsl_vector_get(x, j));
+            gsl_matrix_set(covar, i, j, chain * gsl_matrix_get(covar, i, j));
+        }
+    }
+}
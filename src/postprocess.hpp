@@ -26,7 +26,9 @@
 #include <gsl/gsl_spline.h>
 
 #include "time_series.hpp"
+#include "log_grid.hpp"
 #include "parallel_policy.hpp"
+#include "error_channel.hpp"
 
 #include <vector>
 #include <array>
@@ -35,9 +37,10 @@
 #include <numeric>
 #include <cmath>
 #include <algorithm>
+#include <optional>
 
 template<typename T>
-T RMSE(const std::vector<T>& fit, const std::vector<T>& original)
+T RMSE(Const_span<T> fit, Const_span<T> original)
 {
     // Define error functor: (x-y)^2
     auto error_func = [](T a, T b)
@@ -47,14 +50,16 @@ T RMSE(const std::vector<T>& fit, const std::vector<T>& original)
     };
 
     // Sum over i (x_i - y_i)^2
-    auto sum = std::transform_reduce(exec_policy, fit.begin(), fit.end(), original.begin(), 0.0, std::plus<>(), error_func);
+    auto sum = with_policy(fit.size(), [&](const auto& policy) {
+        return std::transform_reduce(policy, fit.begin(), fit.end(), original.begin(), 0.0, std::plus<>(), error_func);
+    });
     
     // Square root of average error
     return std::sqrt(sum / static_cast<T>(fit.size()));
 }
 
 template<typename T>
-T NRMSE_range(const std::vector<T>& fit, const std::vector<T>& original)
+T NRMSE_range(Const_span<T> fit, Const_span<T> original)
 {
     T rmse = RMSE<T>(fit, original);
 
@@ -64,7 +69,7 @@ T NRMSE_range(const std::vector<T>& fit, const std::vector<T>& original)
 }
 
 template<typename T>
-T NRMSE_average(const std::vector<T>& fit, const std::vector<T>& original)
+T NRMSE_average(Const_span<T> fit, Const_span<T> original)
 {
     T rmse = RMSE<T>(fit, original);
 
@@ -73,6 +78,20 @@ T NRMSE_average(const std::vector<T>& fit, const std::vector<T>& original)
     return rmse / avg;
 }
 
+// Information criteria of a least squares fit with residual sum of squares rss over n points and k free variables,
+// assuming Gaussian errors. Only differences between models fitted to the same data are meaningful.
+template<typename T>
+T AIC(T rss, size_t n, size_t k)
+{
+    return static_cast<T>(n) * std::log(rss / static_cast<T>(n)) + static_cast<T>(2 * k);
+}
+
+template<typename T>
+T BIC(T rss, size_t n, size_t k)
+{
+    return static_cast<T>(n) * std::log(rss / static_cast<T>(n)) + static_cast<T>(k) * std::log(static_cast<T>(n));
+}
+
 template<typename Functor_t>
 Time_series derivative(const Functor_t& func, const Time_series::time_type& time_range)
 {
@@ -84,11 +103,16 @@ Time_series derivative(const Functor_t& func, const Time_series::time_type& time
 #endif
 
     Time_series result(time_range);
+    Error_channel errors;
 
-    std::transform(exec_policy, time_range->begin(), time_range->end(), result.begin(), [&func](const Time_series::time_primitive &t) {
-        return finite_difference_derivative<Functor_t, Time_series::time_primitive, 8>(func, t);
+    with_sync_policy(time_range->size(), [&](const auto& policy) {
+        std::transform(policy, time_range->begin(), time_range->end(), result.begin(), errors.guard([&func](const Time_series::time_primitive &t) {
+            return finite_difference_derivative<Functor_t, Time_series::time_primitive, 8>(func, t);
+        }));
     });
 
+    errors.rethrow_if_failed();
+
     return result;
 }
 
@@ -97,11 +121,13 @@ Time_series dimensionless_derivative(const Functor_t& func, const Time_series::t
 {
     auto derivative_result = derivative(func, time_range);
 
-    std::for_each(exec_policy, derivative_result.time_zipped_begin(), derivative_result.time_zipped_end(), [ctx](auto val) mutable -> double {
-        double& time = boost::get<0>(val);
-        double& value = boost::get<1>(val);
+    with_policy(time_range->size(), [&](const auto& policy) {
+        std::for_each(policy, derivative_result.time_zipped_begin(), derivative_result.time_zipped_end(), [ctx](auto val) mutable -> double {
+            const double& time = boost::get<0>(val);
+            double& value = boost::get<1>(val);
                 
-        return value *= -4.0*ctx->Z*std::pow(ctx->tau_e, 0.25)*std::pow(time, 0.75);
+            return value *= -4.0*ctx->Z*std::pow(ctx->tau_e, 0.25)*std::pow(time, 0.75);
+        });
     });
 
     return derivative_result;
@@ -117,8 +143,11 @@ struct Schwarzl
     std::vector<double> g_t_;
     std::vector<double> t_;
 
-    Schwarzl(const std::vector<double>& g_t, const std::vector<double>& t)
-    : g_t_{g_t}, t_{t}
+    // Set for log uniform time points, whose intervals are found without searching
+    std::optional<Log_grid> grid_;
+
+    Schwarzl(Const_span<double> g_t, const std::vector<double>& t)
+    : g_t_(g_t.begin(), g_t.end()), t_{t}, grid_{Log_grid::detect(t)}
     {
         acc = gsl_interp_accel_alloc();
         spline = gsl_spline_alloc (gsl_interp_cspline, g_t_.size());
@@ -137,7 +166,13 @@ struct Schwarzl
             else if (current_t >= t_.back())
                 val = g_t_.back();
             else
+            {
+                // GSL tries the cached interval before searching
+                if (grid_)
+                    acc->cache = grid_->index_of(current_t);
+
                 val = gsl_spline_eval (spline, current_t, acc);
+            }
 
             current_t *= 2.0;
         }
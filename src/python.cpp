@@ -16,6 +16,7 @@
 #include <pybind11/functional.h>
 
 #include <functional>
+#include <cmath>
 
 #include "context.hpp"
 #include "tube.hpp"
@@ -26,6 +27,9 @@
 #include "constraint_release/rubinsteincolby.hpp"
 #include "constraint_release/heuzey.hpp"
 #include "constraint_release/doublereptation.hpp"
+#include "parallel_policy.hpp"
+#include "batch.hpp"
+#include "buffer_pool.hpp"
 
 // A few wrappers to make things easier:
 
@@ -53,23 +57,52 @@ auto get_cb()
     return cb;
 }
 
-void fit(bool decouple, ICS_result &result, const std::vector<double> &input, double weighting, std::function<void()>& python_callback)
+// Applies the options every fit takes, then fits
+template <typename... T>
+void run_fit(Fit<T...>& fit_driver, ICS_result &result, const Time_series::value_type &input, double weighting, std::function<void()>& python_callback,
+    bool geodesic, bool log_params, bool multilevel, std::shared_ptr<const Cancellation_token> cancellation)
 {
-    if (decouple)
+    fit_driver.callback_func = get_cb<T...>();
+    fit_driver.callback_params = static_cast<void*>(&python_callback);
+    if (geodesic)
+        fit_driver.use_geodesic_acceleration();
+    if (log_params)
+        fit_driver.use_log_transform();
+    fit_driver.cancellation = cancellation;
+    if (multilevel)
+        fit_multilevel(fit_driver, input, result, weighting);
+    else
+        fit_driver.fit(input, result, weighting);
+
+    // Cancelled before its first evaluation, the result still shows the initial guess
+    if (not std::isfinite(fit_driver.cost))
+        result.calculate();
+}
+
+void fit(bool decouple, ICS_result &result, const Time_series::value_type &input, double weighting, std::function<void()>& python_callback, bool geodesic, bool separable, bool log_params, bool multilevel, double time_budget)
+{
+    std::shared_ptr<const Cancellation_token> cancellation;
+
+    if (time_budget > 0.0)
+        cancellation = std::make_shared<Cancellation_token>(time_budget);
+
+    if (decouple and separable)
+    {
+        Fit fit_driver(result.context_->N_e, result.context_->tau_monomer);
+        fit_driver.eliminate_linear_scale(result.context_->G_e);
+        run_fit(fit_driver, result, input, weighting, python_callback, geodesic, log_params, multilevel, cancellation);
+    }
+    else if (decouple)
     {
         Fit fit_driver(result.context_->N_e, result.context_->tau_monomer, result.context_->G_e);
-        fit_driver.callback_func = get_cb<double, double, double>();
-        fit_driver.callback_params = static_cast<void*>(&python_callback);
-        fit_driver.fit(input, result, weighting);
+        run_fit(fit_driver, result, input, weighting, python_callback, geodesic, log_params, multilevel, cancellation);
     }
     else
     {
         Fit fit_driver(result.context_->N_e, result.context_->tau_monomer);
-        fit_driver.callback_func = get_cb<double, double>();
-        fit_driver.callback_params = static_cast<void *>(&python_callback);
-        fit_driver.fit(input, result, weighting);
+        run_fit(fit_driver, result, input, weighting, python_callback, geodesic, log_params, multilevel, cancellation);
     }
-}       
+}
 
 std::string context_view_to_comment(IContext_view& view)
 {
@@ -139,17 +172,41 @@ PYBIND11_MODULE(lime_python, m)
 
     pybind11::class_<ICS_result>(m, "ICS_result")
         .def(pybind11::init([](const Time_range::base &time, ICS_context_builder *builder, constraint_release::impl impl, bool observes_context) {
-            return ICS_result(std::make_shared<Time_range::base>(time), builder, impl, observes_context);
+            return ICS_result(Time_range::convert(time), builder, impl, observes_context);
         }))
-        .def("calculate", &ICS_result::calculate)
+        .def("calculate", pybind11::overload_cast<>(&ICS_result::calculate))
         .def("get_values", &ICS_result::get_values)
         .def("set_cv", [](const ICS_result &res, double cv) { res.CR->c_v_ = cv; })
         .def("update_callback", [](const ICS_result &res) { res.CR->update(*res.context_); });
 
-    m.def("fit", &fit);
+    pybind11::class_<Parameter_batch>(m, "Parameter_batch")
+        .def(pybind11::init<>())
+        .def_readwrite("Z", &Parameter_batch::Z)
+        .def_readwrite("tau_e", &Parameter_batch::tau_e)
+        .def_readwrite("G_e", &Parameter_batch::G_e)
+        .def_readwrite("c_v", &Parameter_batch::c_v)
+        .def_readwrite("N", &Parameter_batch::N)
+        .def("push_back", &Parameter_batch::push_back);
+
+    pybind11::class_<Batch_evaluator>(m, "Batch_evaluator")
+        .def(pybind11::init([](const Time_range::base &time, constraint_release::impl impl) {
+            return Batch_evaluator(Time_range::convert(time), impl);
+        }))
+        .def("evaluate", pybind11::overload_cast<const Parameter_batch&>(&Batch_evaluator::evaluate, pybind11::const_))
+        .def("time_points", &Batch_evaluator::time_points);
+
+    m.def("fit", &fit,
+        pybind11::arg("decouple"), pybind11::arg("result"), pybind11::arg("input"), pybind11::arg("weighting"), pybind11::arg("callback"),
+        pybind11::arg("geodesic") = false, pybind11::arg("separable") = false, pybind11::arg("log_params") = false, pybind11::arg("multilevel") = false, pybind11::arg("time_budget") = 0.0);
 
     m.def("context_view_to_comment", &context_view_to_comment);
 
+    m.def("set_num_threads", [](size_t threads) { Execution_context::get().set_num_threads(threads); }, pybind11::arg("threads"));
+    m.def("get_num_threads", []() { return Execution_context::get().num_threads(); });
+
+    m.def("set_buffer_pool", [](bool enabled) { Buffer_pool::set_enabled(enabled); }, pybind11::arg("enabled"));
+    m.def("get_buffer_pool", []() { return Buffer_pool::enabled(); });
+
     /*
     Currently, this seems to cause lifetime issues. we'll use a wrapper for now.
 
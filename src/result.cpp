@@ -15,16 +15,47 @@
 #include "contour_length_fluctuations.hpp"
 #include "utilities.hpp"
 #include "parallel_policy.hpp"
+#include "error_channel.hpp"
+#include "autotune.hpp"
 #include "postprocess.hpp"
 
 #include <algorithm>
+#include <stdexcept>
+
+namespace
+{
+    // Kernels of the model, one per constraint release
+    const Kernel_id&
+    ics_kernel(constraint_release::impl impl)
+    {
+        static const Kernel_id heuzey{constraint_release::kernel_name(constraint_release::impl::HEUZEY)};
+        static const Kernel_id rubinsteincolby{constraint_release::kernel_name(constraint_release::impl::RUBINSTEINCOLBY)};
+        static const Kernel_id doublereptation{constraint_release::kernel_name(constraint_release::impl::DOUBLEREPTATION)};
+
+        switch (impl)
+        {
+            case constraint_release::impl::HEUZEY:          return heuzey;
+            case constraint_release::impl::RUBINSTEINCOLBY: return rubinsteincolby;
+            case constraint_release::impl::DOUBLEREPTATION: return doublereptation;
+        }
+
+        throw std::runtime_error("Unknown constraint release implementation.");
+    }
+}
 
 IResult::IResult(Time_series::time_type time_range)
 :   Time_series{time_range}
 {}
 
+void
+IResult::set_time_range(Time_series::time_type time_range)
+{
+    time_range_ = time_range;
+    values_.assign(time_range_->size(), 0.0);
+}
+
 ICS_result::ICS_result(Time_series::time_type time_range, IContext_builder* builder, constraint_release::impl impl, bool cr_observes_context)
-:   IResult(time_range)
+:   IResult(time_range), kernel_{&ics_kernel(impl)}
 {
     // Build context
     builder->gather_physics();
@@ -44,21 +75,71 @@ ICS_result::ICS_result(Time_series::time_type time_range, IContext_builder* buil
     CLF = std::make_unique<Contour_length_fluctuations>(*context_);
 }
 
+ICS_result::ICS_result(Time_series::time_type time_range, IContext_builder* builder, constraint_release::impl impl, std::unique_ptr<IConstraint_release> cr)
+:   IResult(time_range), CR{std::move(cr)}, kernel_{&ics_kernel(impl)}
+{
+    builder->gather_physics();
+    builder->initialize();
+    builder->validate_state();
+    context_ = builder->get_context();
+
+    CLF = std::make_unique<Contour_length_fluctuations>(*context_);
+}
+
 void
 ICS_result::calculate()
+{
+    // A surrogate is cheap, so the token is checked once it filled the values
+    if (surrogate and surrogate(*context_, values_.data()))
+    {
+        if (cancellation)
+            cancellation->throw_if_cancelled();
+
+        return;
+    }
+
+    calculate(0, time_range_->size(), values_.data());
+}
+
+void
+ICS_result::calculate(size_t first, size_t last, Time_series::value_primitive* out)
 {
     if (!context_)
     {
         throw std::runtime_error("No context for ICS result!");
     }
 
+    if (first > last or last > time_range_->size())
+    {
+        throw std::out_of_range("Tried to calculate ICS result outside of its time range.");
+    }
+
     Longitudinal_motion LM = get_longitudinal_motion();
     Rouse_motion RM = get_rouse_motion();
 
-    std::transform(exec_policy, time_range_->begin(), time_range_->end(), values_.begin(),
-        [this, &LM, &RM](const double& t){ 
-        return context_->G_e* (4.0/5.0 * (*CR)(t) * (*CLF)(t) + LM(t) + RM(t) );}
-    );
+    auto model = [this, &LM, &RM](const double& t){ 
+        return context_->G_e* (4.0/5.0 * (*CR)(t) * (*CLF)(t) + LM(t) + RM(t) );};
+
+    Error_channel errors;
+
+    auto set_inner_chunk = [this](size_t chunk) { CR->set_inner_chunk(chunk); };
+    auto inner_regions = [this]() { return CR->inner_regions(); };
+
+    if (not cancellation)
+    {
+        tuned_transform(*kernel_, time_range_->begin() + first, time_range_->begin() + last, out, errors.guard(model), CR->inner_work(), set_inner_chunk, inner_regions);
+        errors.rethrow_if_failed();
+        return;
+    }
+
+    // A point costs quadratures, next to which polling the token is cheap. Once it is cancelled the remaining points are skipped.
+    auto cancellable = [this, &model](const double& t){
+        return cancellation->cancelled() ? 0.0 : model(t);};
+
+    tuned_transform(*kernel_, time_range_->begin() + first, time_range_->begin() + last, out, errors.guard(cancellable), CR->inner_work(), set_inner_chunk, inner_regions);
+    errors.rethrow_if_failed();
+
+    cancellation->throw_if_cancelled();
 }
 
 Rouse_motion
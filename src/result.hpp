@@ -19,22 +19,34 @@
 #include "constraint_release/constraint_release.hpp"
 #include "longitudinal_motion.hpp"
 #include "rouse_motion.hpp"
+#include "cancellation.hpp"
+#include "buffer_pool.hpp"
+#include "autotune.hpp"
 
 #include <memory>
 #include <vector>
+#include <functional>
+#include <string>
 
 class IResult : public Time_series
 {
     public:
         explicit IResult(Time_series::time_type time_range);
         virtual void calculate() = 0;
+
+        // Replaces the time points to calculate, values are reset
+        void set_time_range(Time_series::time_type time_range);
 };
 
 struct ICS_result : public IResult
 {
     ICS_result(Time_series::time_type time_range, IContext_builder* builder, constraint_release::impl impl, bool cr_observes_context = true);
+    // Uses cr, a constraint release of the model impl, instead of creating one
+    ICS_result(Time_series::time_type time_range, IContext_builder* builder, constraint_release::impl impl, std::unique_ptr<IConstraint_release> cr);
 
     void calculate() override;
+    // Evaluates the time points [first, last) into out, leaving the stored values untouched
+    void calculate(size_t first, size_t last, Time_series::value_primitive* out);
 
     Rouse_motion get_rouse_motion() const;
     Longitudinal_motion get_longitudinal_motion() const;
@@ -42,6 +54,20 @@ struct ICS_result : public IResult
     std::shared_ptr<Context> context_;
     std::unique_ptr<Contour_length_fluctuations> CLF;
     std::unique_ptr<IConstraint_release> CR;
+
+    // If set, calculate checks it before every time point, skips the rest once it is cancelled and throws Cancelled
+    std::shared_ptr<const Cancellation_token> cancellation;
+
+    // If set, calculate() first offers the context and the values to fill to it, e.g. an emulator of the model.
+    // It returns false if it can't fill them, then the model is evaluated as usual.
+    std::function<bool(const Context&, Time_series::value_primitive*)> surrogate;
+
+    // If set, the buffer pool stays enabled while this result and its copies are alive
+    std::shared_ptr<const Buffer_pool::Scope> pool_scope;
+
+    private:
+        // Profile of this model in the autotuner
+        const Kernel_id* kernel_;
 };
 
 struct Derivative_result : public IResult
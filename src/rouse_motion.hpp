@@ -16,7 +16,7 @@
 #include "context.hpp"
 #include "utilities.hpp"
 #include "time_series.hpp"
-#include "parallel_policy.hpp"
+#include "autotune.hpp"
 
 struct Rouse_motion : private Summation<double, double>
 {
@@ -40,7 +40,8 @@ struct Rouse_motion : private Summation<double, double>
     {
         Time_series res{time_range};
 
-        std::transform(exec_policy, time_range->begin(), time_range->end(), res.begin(), *this);
+        static const Kernel_id kernel{"rouse_motion"};
+        tuned_transform(kernel, time_range->begin(), time_range->end(), res.begin(), *this);
 
         return res;
     }
@@ -0,0 +1,280 @@
+#pragma once
+
+/*
+ *  This file is part of Lime, a tool for the application of Likhtman & McLiesh' model for polymer dyanmics.
+ *
+ *  Copyright © 2020 Daniel Emmery (CNRS)
+ *
+ *  File contents:
+ *
+ *  Affine invariant ensemble MCMC (Goodman & Weare, doi: 10.2140/camcos.2010.5.65) with parallel tempering
+ *
+ *  GPL 3.0 License
+ *
+ */
+
+#include <array>
+#include <vector>
+#include <algorithm>
+#include <numeric>
+#include <random>
+#include <cmath>
+#include <limits>
+#include <functional>
+#include <stdexcept>
+
+#include "parallel_policy.hpp"
+
+// Every temperature holds an ensemble of walkers that move with stretch moves, neighbouring temperatures exchange
+// positions after every step. The coldest temperature samples the posterior, hotter ones flatten the likelihood
+// to cross between modes. Walkers of the same half of an ensemble move concurrently on the thread pool.
+template <size_t P>
+class Tempered_ensemble
+{
+    public:
+        using Point = std::array<double, P>;
+        using Log_prior = std::function<double(const Point&)>;
+        // Called with the slot of the walker, see slot(), so each can evaluate on its own model
+        using Log_likelihood = std::function<double(size_t, const Point&)>;
+
+        // initial holds the starting point of every walker, all temperatures start from them.
+        // Temperature t is ladder^t.
+        Tempered_ensemble(const std::vector<Point>& initial, size_t temperatures, double ladder,
+            Log_prior log_prior, Log_likelihood log_likelihood, unsigned int seed = 0)
+        :   walkers_{initial.size()},
+            betas_(temperatures),
+            positions_{},
+            log_prior_(initial.size() * temperatures),
+            log_likelihood_(initial.size() * temperatures),
+            log_prior_func_{log_prior},
+            log_likelihood_func_{log_likelihood},
+            generators_{},
+            swap_generator_{seed},
+            accepted_(initial.size(), 0),
+            steps_{0},
+            swaps_accepted_{0},
+            swaps_proposed_{0}
+        {
+            if (walkers_ < 2*P or walkers_ % 2 != 0)
+            {
+                throw std::runtime_error("The ensemble needs an even number of walkers, at least twice the number of parameters.");
+            }
+
+            if (temperatures == 0 or ladder < 1.0)
+            {
+                throw std::runtime_error("The temperature ladder needs at least one temperature and a ratio of at least one.");
+            }
+
+            for (size_t t = 0 ; t < temperatures ; ++t)
+            {
+                betas_[t] = std::pow(ladder, -static_cast<double>(t));
+                positions_.insert(positions_.end(), initial.begin(), initial.end());
+            }
+
+            for (size_t s = 0 ; s < positions_.size() ; ++s)
+            {
+                std::seed_seq sequence{seed, static_cast<unsigned int>(s)};
+                generators_.emplace_back(sequence);
+            }
+
+            std::vector<size_t> slots(positions_.size());
+            std::iota(slots.begin(), slots.end(), 0);
+
+            with_task_policy([&](const auto& policy) {
+                std::for_each(policy, slots.begin(), slots.end(), [this](size_t s) {
+                    log_prior_[s] = log_prior_func_(positions_[s]);
+                    log_likelihood_[s] = evaluate(s, positions_[s]);
+                });
+            });
+
+            for (size_t s = 0 ; s < positions_.size() ; ++s)
+            {
+                if (not std::isfinite(log_prior_[s] + log_likelihood_[s]))
+                {
+                    throw std::runtime_error("Initial walker " + std::to_string(s % walkers_) + " has zero posterior probability.");
+                }
+            }
+        }
+
+        // One stretch move of every walker at every temperature, followed by the exchanges between temperatures
+        void
+        step()
+        {
+            std::vector<size_t> slots;
+
+            for (size_t half = 0 ; half < 2 ; ++half)
+            {
+                slots.clear();
+
+                for (size_t t = 0 ; t < betas_.size() ; ++t)
+                {
+                    for (size_t k = half * walkers_/2 ; k < (half + 1) * walkers_/2 ; ++k)
+                    {
+                        slots.push_back(slot(t, k));
+                    }
+                }
+
+                // Walkers only read positions of the other half, which stays put
+                with_task_policy([&](const auto& policy) {
+                    std::for_each(policy, slots.begin(), slots.end(), [this, half](size_t s) { stretch(s, half); });
+                });
+            }
+
+            exchange();
+
+            ++steps_;
+        }
+
+        size_t
+        walkers() const
+        {
+            return walkers_;
+        }
+
+        size_t
+        temperatures() const
+        {
+            return betas_.size();
+        }
+
+        size_t
+        slot(size_t temperature, size_t walker) const
+        {
+            return temperature * walkers_ + walker;
+        }
+
+        // Of the coldest temperature
+        const Point&
+        position(size_t walker) const
+        {
+            return positions_[walker];
+        }
+
+        double
+        log_posterior(size_t walker) const
+        {
+            return log_prior_[walker] + log_likelihood_[walker];
+        }
+
+        // Of the stretch moves of the coldest temperature
+        double
+        acceptance_fraction() const
+        {
+            const size_t accepted = std::accumulate(accepted_.begin(), accepted_.end(), size_t{0});
+            return steps_ > 0 ? static_cast<double>(accepted) / static_cast<double>(steps_ * walkers_) : 0.0;
+        }
+
+        double
+        swap_fraction() const
+        {
+            return swaps_proposed_ > 0 ? static_cast<double>(swaps_accepted_) / static_cast<double>(swaps_proposed_) : 0.0;
+        }
+
+    private:
+        // Scale of the stretch move, 2 as recommended by Goodman & Weare
+        static constexpr double a = 2.0;
+
+        size_t walkers_;
+        std::vector<double> betas_;
+        std::vector<Point> positions_;
+        std::vector<double> log_prior_;
+        std::vector<double> log_likelihood_;
+        Log_prior log_prior_func_;
+        Log_likelihood log_likelihood_func_;
+        // One per slot, so moves don't depend on the scheduling
+        std::vector<std::mt19937> generators_;
+        std::mt19937 swap_generator_;
+        std::vector<size_t> accepted_;
+        size_t steps_;
+        size_t swaps_accepted_;
+        size_t swaps_proposed_;
+
+        // Failed model evaluations reject the move
+        double
+        evaluate(size_t s, const Point& point) const
+        {
+            try
+            {
+                return log_likelihood_func_(s, point);
+            }
+            catch (const std::exception&)
+            {
+                return -std::numeric_limits<double>::infinity();
+            }
+        }
+
+        void
+        stretch(size_t s, size_t half)
+        {
+            auto& generator = generators_[s];
+            std::uniform_real_distribution<double> uniform(0.0, 1.0);
+            std::uniform_int_distribution<size_t> partner_in_half(0, walkers_/2 - 1);
+
+            const size_t t = s / walkers_;
+            const size_t partner = slot(t, (1 - half) * walkers_/2 + partner_in_half(generator));
+
+            // z is distributed as 1/sqrt(z) on [1/a, a]
+            const double z = std::pow((a - 1.0) * uniform(generator) + 1.0, 2.0) / a;
+
+            Point proposal;
+
+            for (size_t i = 0 ; i < P ; ++i)
+            {
+                proposal[i] = positions_[partner][i] + z * (positions_[s][i] - positions_[partner][i]);
+            }
+
+            const double log_prior = log_prior_func_(proposal);
+
+            if (not std::isfinite(log_prior))
+            {
+                return;
+            }
+
+            const double log_likelihood = evaluate(s, proposal);
+
+            const double log_acceptance = static_cast<double>(P - 1) * std::log(z)
+                + (log_prior + betas_[t] * log_likelihood) - (log_prior_[s] + betas_[t] * log_likelihood_[s]);
+
+            if (std::log(uniform(generator)) < log_acceptance)
+            {
+                positions_[s] = proposal;
+                log_prior_[s] = log_prior;
+                log_likelihood_[s] = log_likelihood;
+
+                if (t == 0)
+                {
+                    ++accepted_[s];
+                }
+            }
+        }
+
+        // Walkers with the same index at neighbouring temperatures swap with probability
+        // min(1, exp((beta_cold - beta_hot) * (log_likelihood_hot - log_likelihood_cold)))
+        void
+        exchange()
+        {
+            std::uniform_real_distribution<double> uniform(0.0, 1.0);
+
+            for (size_t t = betas_.size() - 1 ; t > 0 ; --t)
+            {
+                for (size_t k = 0 ; k < walkers_ ; ++k)
+                {
+                    const size_t cold = slot(t - 1, k);
+                    const size_t hot = slot(t, k);
+
+                    const double log_acceptance = (betas_[t - 1] - betas_[t]) * (log_likelihood_[hot] - log_likelihood_[cold]);
+
+                    ++swaps_proposed_;
+
+                    if (std::log(uniform(swap_generator_)) < log_acceptance)
+                    {
+                        std::swap(positions_[cold], positions_[hot]);
+                        std::swap(log_prior_[cold], log_prior_[hot]);
+                        std::swap(log_likelihood_[cold], log_likelihood_[hot]);
+
+                        ++swaps_accepted_;
+                    }
+                }
+            }
+        }
+};
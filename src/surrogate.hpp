@@ -0,0 +1,248 @@
+#pragma once
+
+/*
+ *  This file is part of Lime, a tool for the application of Likhtman & McLiesh' model for polymer dyanmics.
+ *
+ *  Copyright © 2020 Daniel Emmery (CNRS)
+ *
+ *  File contents:
+ *
+ *  Emulator of a model over a box in parameter space, to fit on before polishing with the exact model
+ *
+ *  GPL 3.0 License
+ *
+ */
+
+#include <array>
+#include <vector>
+#include <algorithm>
+#include <numeric>
+#include <cmath>
+#include <limits>
+#include <functional>
+#include <stdexcept>
+#include <string>
+
+#include <boost/math/constants/constants.hpp>
+
+#include "parallel_policy.hpp"
+#include "error_channel.hpp"
+#include "parameter_transform.hpp"
+
+// Tensor product Chebyshev interpolation of the logarithm of every model value, in the logarithm of the parameters.
+// Model values like G(t) span decades in time and vary smoothly with the logarithm of the parameters, which keeps
+// the degree needed low. Points outside of the box are clamped onto it.
+template <size_t P>
+class Chebyshev_emulator
+{
+    public:
+        using Point = std::array<double, P>;
+        // Evaluates the exact model at a point into out, which holds size values that must be positive.
+        // Calls for the same worker never overlap, so every worker can evaluate on its own model.
+        using Sample = std::function<void(size_t worker, const Point& point, double* out)>;
+
+        // Highest number of Chebyshev polynomials per parameter, so an evaluation keeps them on the stack
+        static constexpr size_t max_order = 32;
+
+        // Evaluates the model at the (degree+1)^P Chebyshev nodes of the box, spread over workers concurrently
+        Chebyshev_emulator(const std::array<Bounds, P>& bounds, size_t degree, size_t size, size_t workers, Sample sample)
+        :   lower_{}, upper_{}, degree_{degree}, size_{size}, coefficients_{}
+        {
+            if (degree + 1 > max_order)
+            {
+                throw std::runtime_error("An emulator supports degrees up to " + std::to_string(max_order - 1) + ".");
+            }
+
+            for (size_t i = 0 ; i < P ; ++i)
+            {
+                if (not bounds[i].bounded() or bounds[i].lower <= 0.0)
+                {
+                    throw std::runtime_error("An emulator requires positive, finite bounds for all parameters.");
+                }
+
+                lower_[i] = std::log(bounds[i].lower);
+                upper_[i] = std::log(bounds[i].upper);
+            }
+
+            const size_t order = degree_ + 1;
+            const size_t count = nodes();
+
+            workers = std::max<size_t>(1, std::min(workers, count));
+
+            // cos(pi j (m + 1/2) / order): T_j at node m
+            std::vector<double> T(order * order);
+
+            for (size_t j = 0 ; j < order ; ++j)
+            {
+                for (size_t m = 0 ; m < order ; ++m)
+                {
+                    T[j*order + m] = std::cos(boost::math::constants::pi<double>() * static_cast<double>(j) * (static_cast<double>(m) + 0.5) / static_cast<double>(order));
+                }
+            }
+
+            std::vector<double> values(count * size_);
+            std::vector<size_t> worker_indices(workers);
+            std::iota(worker_indices.begin(), worker_indices.end(), 0);
+
+            Error_channel errors;
+
+            with_task_policy([&](const auto& policy) {
+                std::for_each(policy, worker_indices.begin(), worker_indices.end(), errors.guard([&](size_t worker) {
+                    // The other workers stop at their next node once one failed
+                    for (size_t node = worker ; node < count and not errors.failed() ; node += workers)
+                    {
+                        const auto m = multi_index(node);
+                        Point point;
+
+                        for (size_t i = 0 ; i < P ; ++i)
+                        {
+                            // T_1 at node m is the node's position in [-1, 1]
+                            point[i] = std::exp(from_unit(T[order + m[i]], i));
+                        }
+
+                        double* out = values.data() + node * size_;
+                        sample(worker, point, out);
+
+                        std::transform(out, out + size_, out, [](double value) {
+                            return std::log(std::max(value, std::numeric_limits<double>::min()));
+                        });
+                    }
+                }));
+            });
+
+            errors.rethrow_if_failed();
+
+            // c_j = prod_i (2 - delta_{j_i 0}) / order * sum_m f_m prod_i T_{j_i}(x_{m_i})
+            coefficients_.assign(count * size_, 0.0);
+
+            std::vector<size_t> coefficient_indices(count);
+            std::iota(coefficient_indices.begin(), coefficient_indices.end(), 0);
+
+            with_policy(coefficient_indices.size(), [&](const auto& policy) {
+                std::for_each(policy, coefficient_indices.begin(), coefficient_indices.end(), [&](size_t k) {
+                    const auto j = multi_index(k);
+                    double* c = coefficients_.data() + k * size_;
+
+                    for (size_t node = 0 ; node < count ; ++node)
+                    {
+                        const auto m = multi_index(node);
+                        double weight{1.0};
+
+                        for (size_t i = 0 ; i < P ; ++i)
+                        {
+                            weight *= (j[i] == 0 ? 1.0 : 2.0) / static_cast<double>(order) * T[j[i]*order + m[i]];
+                        }
+
+                        const double* f = values.data() + node * size_;
+
+                        for (size_t t = 0 ; t < size_ ; ++t)
+                        {
+                            c[t] += weight * f[t];
+                        }
+                    }
+                });
+            });
+        }
+
+        void
+        operator()(const Point& point, double* out) const
+        {
+            const size_t order = degree_ + 1;
+
+            // Chebyshev polynomials of every dimension at the point, by their recurrence
+            std::array<std::array<double, max_order>, P> T;
+
+            for (size_t i = 0 ; i < P ; ++i)
+            {
+                const double x = std::clamp(to_unit(std::log(point[i]), i), -1.0, 1.0);
+
+                T[i][0] = 1.0;
+
+                if (order > 1)
+                {
+                    T[i][1] = x;
+                }
+
+                for (size_t j = 2 ; j < order ; ++j)
+                {
+                    T[i][j] = 2.0 * x * T[i][j-1] - T[i][j-2];
+                }
+            }
+
+            std::fill(out, out + size_, 0.0);
+
+            for (size_t k = 0 ; k < nodes() ; ++k)
+            {
+                const auto j = multi_index(k);
+                double basis{1.0};
+
+                for (size_t i = 0 ; i < P ; ++i)
+                {
+                    basis *= T[i][j[i]];
+                }
+
+                const double* c = coefficients_.data() + k * size_;
+
+                for (size_t t = 0 ; t < size_ ; ++t)
+                {
+                    out[t] += basis * c[t];
+                }
+            }
+
+            std::transform(out, out + size_, out, [](double value) { return std::exp(value); });
+        }
+
+        // Number of exact model evaluations the emulator was built from
+        size_t
+        nodes() const
+        {
+            size_t count{1};
+
+            for (size_t i = 0 ; i < P ; ++i)
+            {
+                count *= degree_ + 1;
+            }
+
+            return count;
+        }
+
+        size_t
+        size() const
+        {
+            return size_;
+        }
+
+    private:
+        Point lower_;
+        Point upper_;
+        size_t degree_;
+        size_t size_;
+        // Per basis function, the coefficients of all model values
+        std::vector<double> coefficients_;
+
+        std::array<size_t, P>
+        multi_index(size_t k) const
+        {
+            std::array<size_t, P> index;
+
+            for (size_t i = 0 ; i < P ; ++i)
+            {
+                index[i] = k % (degree_ + 1);
+                k /= degree_ + 1;
+            }
+
+            return index;
+        }
+
+        double
+        to_unit(double x, size_t i) const
+        {
+            return 2.0 * (x - lower_[i]) / (upper_[i] - lower_[i]) - 1.0;
+        }
+
+        double
+        from_unit(double u, size_t i) const
+        {
+            return lower_[i] + (u + 1.0) / 2.0 * (upper_[i] - lower_[i]);
+        }
+};
@@ -0,0 +1,145 @@
+/*
+ *  This file is part of Lime, a tool for the application of Likhtman & McLiesh' model for polymer dyanmics.
+ *
+ *  Copyright © 2020 Daniel Emmery (CNRS)
+ *
+ *  File contents:
+ *
+ *  Registry of time grids, which shares equal grids between results and identifies them
+ *
+ *  GPL 3.0 License
+ *
+ */
+
+#include "time_grid.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <cmath>
+
+Time_grid_registry&
+Time_grid_registry::get()
+{
+    static Time_grid_registry registry;
+    return registry;
+}
+
+Time_grid_registry::grid_ptr
+Time_grid_registry::intern(grid_ptr grid, double base, double max, double norm)
+{
+    const std::size_t grid_hash = hash(*grid);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    prune();
+
+    const auto [first, last] = by_hash_.equal_range(grid_hash);
+
+    for (auto candidate = first ; candidate != last ; ++candidate)
+    {
+        auto& entry = entries_.at(candidate->second);
+
+        if (auto registered = entry.grid.lock() ; registered and *registered == *grid)
+        {
+            // The grid may have been registered without its parameters, e.g. converted before it was generated
+            for (auto [known, given] : {std::pair{&entry.info.base, base}, std::pair{&entry.info.max, max}, std::pair{&entry.info.norm, norm}})
+            {
+                if (std::isnan(*known))
+                    *known = given;
+            }
+
+            return registered;
+        }
+    }
+
+    entries_.emplace(grid.get(), Entry{grid, Time_grid_info{next_id_++, grid_hash, base, max, norm}});
+    by_hash_.emplace(grid_hash, grid.get());
+
+    return grid;
+}
+
+std::optional<Time_grid_info>
+Time_grid_registry::info(const grid_ptr& grid) const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    const auto entry = entries_.find(grid.get());
+
+    // The address may have been reused after the registered grid was dropped
+    if (entry == entries_.end() or entry->second.grid.lock() != grid)
+    {
+        return std::nullopt;
+    }
+
+    return entry->second.info;
+}
+
+bool
+Time_grid_registry::compatible(const grid_ptr& lhs, const grid_ptr& rhs) const
+{
+    if (lhs == rhs)
+    {
+        return true;
+    }
+
+    if (lhs->size() != rhs->size())
+    {
+        return false;
+    }
+
+    if (info(lhs) and info(rhs))
+    {
+        return false;
+    }
+
+    return *lhs == *rhs;
+}
+
+// FNV-1a over the size and the bits of every time point
+std::size_t
+Time_grid_registry::hash(const grid_type& grid)
+{
+    std::uint64_t result = 14695981039346656037ull;
+
+    auto combine = [&result](std::uint64_t word) {
+        for (size_t byte = 0 ; byte < sizeof(word) ; ++byte)
+        {
+            result ^= (word >> (8 * byte)) & 0xff;
+            result *= 1099511628211ull;
+        }
+    };
+
+    combine(grid.size());
+
+    for (const double t : grid)
+    {
+        std::uint64_t bits;
+        std::memcpy(&bits, &t, sizeof(bits));
+        combine(bits);
+    }
+
+    return static_cast<std::size_t>(result);
+}
+
+void
+Time_grid_registry::prune()
+{
+    for (auto entry = entries_.begin() ; entry != entries_.end() ; )
+    {
+        if (not entry->second.grid.expired())
+        {
+            ++entry;
+            continue;
+        }
+
+        const auto [first, last] = by_hash_.equal_range(entry->second.info.hash);
+        const auto link = std::find_if(first, last, [&entry](const auto& value) { return value.second == entry->first; });
+
+        if (link != last)
+        {
+            by_hash_.erase(link);
+        }
+
+        entry = entries_.erase(entry);
+    }
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+/*
+ *  This file is part of Lime, a tool for the application of Likhtman & McLiesh' model for polymer dyanmics.
+ *
+ *  Copyright © 2020 Daniel Emmery (CNRS)
+ *
+ *  File contents:
+ *
+ *  Registry of time grids, which shares equal grids between results and identifies them
+ *
+ *  GPL 3.0 License
+ *
+ */
+
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <cstdint>
+#include <limits>
+#include <unordered_map>
+
+struct Time_grid_info
+{
+    // Assigned in order of registration, unique within a run
+    std::uint64_t id;
+    // Of the time points, equal grids hash equally across runs
+    std::size_t hash;
+    // Parameters of generated exponential grids, NaN for other grids
+    double base;
+    double max;
+    double norm;
+};
+
+// Interned grids with equal time points are the same object, so grids are compatible if and only if they are
+// the same pointer. The registry holds grids weakly, a grid is dropped once no result uses it.
+class Time_grid_registry
+{
+    public:
+        using grid_type = std::vector<double>;
+        using grid_ptr = std::shared_ptr<const grid_type>;
+
+        static Time_grid_registry& get();
+
+        // Returns the registered grid with the same time points if there is one, grid otherwise.
+        // Parameters the registered grid lacks are taken from this call.
+        grid_ptr intern(grid_ptr grid,
+                        double base = std::numeric_limits<double>::quiet_NaN(),
+                        double max = std::numeric_limits<double>::quiet_NaN(),
+                        double norm = std::numeric_limits<double>::quiet_NaN());
+
+        // Empty if grid was never interned
+        std::optional<Time_grid_info> info(const grid_ptr& grid) const;
+
+        // Constant time if both grids are interned, compares the time points otherwise
+        bool compatible(const grid_ptr& lhs, const grid_ptr& rhs) const;
+
+        static std::size_t hash(const grid_type& grid);
+
+    private:
+        struct Entry
+        {
+            std::weak_ptr<const grid_type> grid;
+            Time_grid_info info;
+        };
+
+        Time_grid_registry() = default;
+
+        // Forgets grids that are no longer used, requires mutex_ to be held
+        void prune();
+
+        mutable std::mutex mutex_;
+        std::unordered_map<const grid_type*, Entry> entries_;
+        std::unordered_multimap<std::size_t, const grid_type*> by_hash_;
+        std::uint64_t next_id_{0};
+};
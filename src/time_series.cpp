@@ -12,31 +12,61 @@
  */
 
 #include "time_series.hpp"
+#include "log_grid.hpp"
 
 #include <algorithm>
 #include <cmath>
 #include <ostream>
 #include <numeric>
 #include <stdexcept>
+#include <limits>
 
 Time_range::type Time_range::generate_exponential(primitive base, primitive max)
 {
-    if (std::abs(base - 1.0) < std::numeric_limits<double>::epsilon())
-    {
-        throw std::runtime_error("Using 1.0 as a base for a logarithmic scale will result in an empty time range.");
-    }
-    Time_range::type time = Time_range::construct(static_cast<size_t>(log_with_base<primitive>(base, max)));
-    std::generate(time->begin(), time->end(), [n=0, base] () mutable {return std::pow(base, n++);});
-    return time;
+    return generate_normalized_exponential(base, max, 1.0);
 }
 
 Time_range::type Time_range::generate_normalized_exponential(primitive base, primitive max, primitive norm)
 {
-    auto&& range = generate_exponential(base, max);
+    const auto grid = Log_grid::exponential(base, max, norm);
 
-    std::for_each(exec_policy, range->begin(), range->end(), [norm](primitive& t){t /= norm;});
+    return Time_grid_registry::get().intern(grid.chunk(0, grid.size()), base, max, norm);
+}
 
-    return std::forward<type>(range);
+std::vector<size_t> Time_range::log_decimate(const base& time, size_t points_per_decade)
+{
+    if (points_per_decade == 0)
+    {
+        throw std::runtime_error("Decimating a time range requires at least one point per decade.");
+    }
+
+    std::vector<size_t> indices;
+    long previous_bin = std::numeric_limits<long>::min();
+
+    for (size_t i = 0 ; i < time.size() ; ++i)
+    {
+        // Can't be binned logarithmically, so always kept
+        if (time[i] <= 0.0)
+        {
+            indices.push_back(i);
+            continue;
+        }
+
+        const long bin = static_cast<long>(std::floor(std::log10(time[i]) * static_cast<double>(points_per_decade)));
+
+        if (bin != previous_bin)
+        {
+            indices.push_back(i);
+            previous_bin = bin;
+        }
+    }
+
+    if (not time.empty() and indices.back() != time.size() - 1)
+    {
+        indices.push_back(time.size() - 1);
+    }
+
+    return indices;
 }
 
 Time_series::Time_series(time_type time_range)
@@ -57,15 +87,17 @@ Time_series::Time_series(const Time_series& other_time_series)
     values_(other_time_series.values_)
 {}
 
+Time_series::Time_series(Time_series&& other_time_series) noexcept = default;
+
 using namespace boost::iterators;
 using namespace boost::tuples;
 
-zip_iterator<tuple<Time_range::base::iterator, Time_series::value_type::iterator>> Time_series::time_zipped_begin()
+zip_iterator<tuple<Time_range::base::const_iterator, Time_series::value_type::iterator>> Time_series::time_zipped_begin()
 {
     return boost::make_zip_iterator(boost::make_tuple(time_range_->begin(), values_.begin()));
 }
 
-zip_iterator<tuple<Time_range::base::iterator, Time_series::value_type::iterator>> Time_series::time_zipped_end()
+zip_iterator<tuple<Time_range::base::const_iterator, Time_series::value_type::iterator>> Time_series::time_zipped_end()
 {
     return boost::make_zip_iterator(boost::make_tuple(time_range_->end(), values_.end()));
 }
@@ -80,7 +112,9 @@ zip_iterator<tuple<Time_range::base::const_iterator, Time_series::value_type::co
     return boost::make_zip_iterator(boost::make_tuple(time_range_->end(), values_.end()));
 }
 
-std::vector<Time_series::value_primitive> Time_series::operator()()
+Time_series& Time_series::operator=(Time_series&& other_time_series) noexcept = default;
+
+Time_series::value_type Time_series::operator()()
 {
     return values_;
 }
@@ -92,41 +126,22 @@ Time_series& Time_series::operator=(const Time_series& other_time_series) noexce
     return *this;
 }
 
-Time_series Time_series::operator*(double constant)
-{
-    Time_series output(*this);
-
-    std::transform(exec_policy, output.begin(), output.end(), output.begin(), std::bind(std::multiplies<double>(), std::placeholders::_1, constant));
-
-    return output;
-}
-
-Time_series Time_series::operator*(const Time_series& other_time_series)
-{
-    return binary_op_new_series(other_time_series, std::multiplies());
-}
-
-Time_series Time_series::operator+(const Time_series &other_time_series)
-{
-    return binary_op_new_series(other_time_series, std::plus());
-}
-
-std::vector<Time_series::value_primitive>::iterator Time_series::begin()
+Time_series::value_type::iterator Time_series::begin()
 {
     return values_.begin();
 }
 
-std::vector<Time_series::value_primitive>::iterator Time_series::end()
+Time_series::value_type::iterator Time_series::end()
 {
     return values_.end();
 }
 
-std::vector<Time_series::value_primitive>::const_iterator Time_series::cbegin() const
+Time_series::value_type::const_iterator Time_series::cbegin() const
 {
     return values_.cbegin();
 }
 
-std::vector<Time_series::value_primitive>::const_iterator Time_series::cend() const
+Time_series::value_type::const_iterator Time_series::cend() const
 {
     return values_.cend();
 }
@@ -146,6 +161,16 @@ Time_series::value_type Time_series::get_values() const
     return values_;
 }
 
+Const_span<Time_series::value_primitive> Time_series::values() const
+{
+    return Const_span<value_primitive>(values_);
+}
+
+Const_span<Time_series::time_primitive> Time_series::times() const
+{
+    return Const_span<time_primitive>(*time_range_);
+}
+
 std::ostream& operator<< (std::ostream &stream, const Time_series& series)
 {
     std::ostream_iterator<boost::tuples::tuple<Time_series::time_primitive, Time_series::value_primitive>> out_it (stream,"\n");
@@ -19,23 +19,33 @@
 #include "context.hpp"
 #include "utilities.hpp"
 #include "parallel_policy.hpp"
+#include "time_grid.hpp"
+#include "buffer_pool.hpp"
 
 #include <vector>
 #include <memory>
 #include <functional>
+#include <algorithm>
+#include <stdexcept>
+#include <type_traits>
 
 struct Time_range
 {
     using primitive = double;
     using base = std::vector<primitive>;
-    using type = std::shared_ptr<base>;
+    // Time points are shared between results, they aren't modified once a result uses them
+    using type = std::shared_ptr<const base>;
 
+    // Generated and converted grids are interned, see Time_grid_registry
     static Time_range::type generate_exponential(primitive base, primitive max);
     static Time_range::type generate_normalized_exponential(primitive base, primitive max, primitive norm);
+    // Indices of an ascending time range, keeping at most points_per_decade points per decade and always the last point
+    static std::vector<size_t> log_decimate(const base& time, size_t points_per_decade);
 
+    // Not interned, as the caller fills in the time points
     template<typename... T>
     static
-    type
+    std::shared_ptr<base>
     construct(T&&... init)
     {
         return std::make_shared<base>(base((std::forward<T>(init), ...)));
@@ -45,14 +55,27 @@ struct Time_range
     type
     convert(const base& init)
     {
-        return std::make_shared<base>(init);
+        return Time_grid_registry::get().intern(std::make_shared<base>(init));
     }
 };
 
-struct Time_series
+// Lazy arithmetic on time series: the operators build expressions, which are evaluated in a single parallel pass
+// into one allocation when a Time_series is constructed or assigned from them. Expressions refer to the time series
+// they are built from, which have to outlive them.
+template <typename E>
+struct Series_expression
+{
+    const E& derived() const
+    {
+        return static_cast<const E&>(*this);
+    }
+};
+
+struct Time_series : Series_expression<Time_series>
 {
     using value_primitive = double;
-    using value_type = std::vector<value_primitive>;
+    // Recycled through Buffer_pool when it is enabled
+    using value_type = std::vector<value_primitive, Pool_allocator<value_primitive>>;
 
     using time_primitive = Time_range::primitive;
     using time_type = Time_range::type;
@@ -60,64 +83,165 @@ struct Time_series
     Time_series(time_type time_range);
     Time_series(time_type time_range, value_type values);
     Time_series(const Time_series& other_time_series);
+    Time_series(Time_series&& other_time_series) noexcept;
     virtual ~Time_series() = default;
 
-    boost::iterators::zip_iterator<boost::tuples::tuple<Time_range::base::iterator, Time_series::value_type::iterator>> time_zipped_begin();
-    boost::iterators::zip_iterator<boost::tuples::tuple<Time_range::base::iterator, Time_series::value_type::iterator>> time_zipped_end();
+    template <typename E>
+    Time_series(const Series_expression<E>& expression)
+    :   time_range_{expression.derived().get_time_range()},
+        values_(time_range_->size())
+    {
+        evaluate(expression.derived());
+    }
+
+    boost::iterators::zip_iterator<boost::tuples::tuple<Time_range::base::const_iterator, Time_series::value_type::iterator>> time_zipped_begin();
+    boost::iterators::zip_iterator<boost::tuples::tuple<Time_range::base::const_iterator, Time_series::value_type::iterator>> time_zipped_end();
 
     boost::iterators::zip_iterator<boost::tuples::tuple<Time_range::base::const_iterator, Time_series::value_type::const_iterator>>  time_zipped_begin() const;
     boost::iterators::zip_iterator<boost::tuples::tuple<Time_range::base::const_iterator, Time_series::value_type::const_iterator>>  time_zipped_end()   const;
 
-    std::vector<value_primitive> operator()();
+    value_type operator()();
     Time_series& operator=(const Time_series& other_time_series) noexcept;
-    Time_series operator+(const Time_series& other_time_series);
-    Time_series operator*(const Time_series& other_time_series);
-    Time_series operator*(double);
+    Time_series& operator=(Time_series&& other_time_series) noexcept;
 
-    std::vector<value_primitive>::iterator begin();
-    std::vector<value_primitive>::iterator end();
+    // Reuses the storage of this series when the sizes match. Every value only depends on the values at the same
+    // time, so the expression may refer to this series.
+    template <typename E>
+    Time_series& operator=(const Series_expression<E>& expression)
+    {
+        time_range_ = expression.derived().get_time_range();
+        values_.resize(time_range_->size());
+        evaluate(expression.derived());
+        return *this;
+    }
 
-    std::vector<value_primitive>::const_iterator cbegin() const;
-    std::vector<value_primitive>::const_iterator cend() const;
+    value_primitive operator[](size_t index) const
+    {
+        return values_[index];
+    }
+
+    value_type::iterator begin();
+    value_type::iterator end();
+
+    value_type::const_iterator cbegin() const;
+    value_type::const_iterator cend() const;
 
     size_t size() const;
 
     friend std::ostream& operator<< (std::ostream& stream, const Time_series& series);
 
     Time_series::time_type get_time_range() const;
+    // Copies, use values() and times() to read without copying
     Time_series::value_type get_values() const;
 
-    template <typename binary_op>
-    Time_series binary_op_new_series(const Time_series &other_time_series, const binary_op &op)
-    {
-        Time_series output(*this);
-
-        std::transform(exec_policy, output.time_zipped_begin(), output.time_zipped_end(), other_time_series.time_zipped_begin(), output.begin(),
-            [&op](auto output, auto other) mutable -> double {
-                const double &output_time = boost::get<0>(output);
-                const double &output_value = boost::get<1>(output);
-                const double &other_time = boost::get<0>(other);
-                const double &other_value = boost::get<1>(other);
-
-                if (output_time == other_time)
-                {
-                    return op(output_value, other_value);
-                }
-                else
-                {
-                    throw std::runtime_error("Tried to add two incompatible time series");
-                }
-            }
-        );
-
-        return output;
-    };
+    // Valid until the series is modified or resized
+    Const_span<value_primitive> values() const;
+    Const_span<time_primitive> times() const;
 
     protected:
         Time_series::time_type time_range_;
         Time_series::value_type values_;
+
+    private:
+        template <typename E>
+        void evaluate(const E& expression)
+        {
+            const value_primitive* first = values_.data();
+
+            with_policy(values_.size(), [&](const auto& policy) {
+                std::for_each(policy, values_.begin(), values_.end(), [&expression, first](value_primitive& value) {
+                    value = expression[static_cast<size_t>(&value - first)];
+                });
+            });
+        }
+};
+
+namespace series_expression
+{
+    // Time series are held by reference, intermediate expressions by value
+    template <typename E>
+    using operand_t = std::conditional_t<std::is_base_of_v<Time_series, E>, const E&, E>;
+}
+
+template <typename L, typename R, typename Op>
+struct Series_binary : Series_expression<Series_binary<L, R, Op>>
+{
+    // Time grids are compared once per expression, not per value
+    Series_binary(const L& lhs, const R& rhs)
+    :   lhs_{lhs}, rhs_{rhs}, time_range_{lhs.get_time_range()}
+    {
+        if (not Time_grid_registry::get().compatible(time_range_, rhs.get_time_range()))
+        {
+            throw std::runtime_error("Tried to combine two incompatible time series");
+        }
+    }
+
+    Time_series::value_primitive operator[](size_t index) const
+    {
+        return Op{}(lhs_[index], rhs_[index]);
+    }
+
+    Time_series::time_type get_time_range() const
+    {
+        return time_range_;
+    }
+
+    private:
+        series_expression::operand_t<L> lhs_;
+        series_expression::operand_t<R> rhs_;
+        Time_series::time_type time_range_;
 };
 
+template <typename E>
+struct Series_scaled : Series_expression<Series_scaled<E>>
+{
+    Series_scaled(const E& operand, Time_series::value_primitive factor)
+    :   operand_{operand}, factor_{factor}
+    {}
+
+    Time_series::value_primitive operator[](size_t index) const
+    {
+        return factor_ * operand_[index];
+    }
+
+    Time_series::time_type get_time_range() const
+    {
+        return operand_.get_time_range();
+    }
+
+    private:
+        series_expression::operand_t<E> operand_;
+        Time_series::value_primitive factor_;
+};
+
+template <typename L, typename R>
+Series_binary<L, R, std::plus<Time_series::value_primitive>>
+operator+(const Series_expression<L>& lhs, const Series_expression<R>& rhs)
+{
+    return {lhs.derived(), rhs.derived()};
+}
+
+template <typename L, typename R>
+Series_binary<L, R, std::multiplies<Time_series::value_primitive>>
+operator*(const Series_expression<L>& lhs, const Series_expression<R>& rhs)
+{
+    return {lhs.derived(), rhs.derived()};
+}
+
+template <typename E>
+Series_scaled<E>
+operator*(const Series_expression<E>& operand, Time_series::value_primitive factor)
+{
+    return {operand.derived(), factor};
+}
+
+template <typename E>
+Series_scaled<E>
+operator*(Time_series::value_primitive factor, const Series_expression<E>& operand)
+{
+    return {operand.derived(), factor};
+}
+
 struct Time_functor
 {
     using function_t = std::function<Time_series::value_primitive(Time_series::time_primitive)>;
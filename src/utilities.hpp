@@ -23,6 +23,7 @@
 #include <memory>
 #include <any>
 #include <ostream>
+#include <vector>
 
 static constexpr double pi = 3.14159265359;
 static constexpr double gas_constant = 1; // m^2 kg s^-2 K^-1 mol^-1
@@ -36,34 +37,18 @@ T log_with_base(T base, T x)
 }
 
 template<typename T>
-struct sigmoid_wrapper
+inline T
+sigmoid(T x)
 {
-    T& value;
-
-    sigmoid_wrapper(T& value_) : value{value_} {}
-
-    operator T&() { return value; }
-    operator T() const { return value; }
-
-    template<typename Y>
-    friend std::ostream& operator<< (std::ostream &out, const sigmoid_wrapper<Y>& sigmoid);
-
-    T operator =(T value_) {return sigmoid(value_);}
-    T operator =(T value_) const {return sigmoid(value_);}
-
-    double
-    sigmoid(double in)
-    {
-        return value = 1/(1+std::abs(in));
-    }
-};
+    return 1.0/(1.0+std::exp(-x));
+}
 
+// Inverse of the sigmoid
 template<typename T>
-std::ostream& operator<< (std::ostream &out, const sigmoid_wrapper<T>& sigmoid)
+inline T
+logit(T p)
 {
-    out << sigmoid.value;
- 
-    return out;
+    return std::log(p/(1.0-p));
 }
 
 template<typename T>
@@ -73,6 +58,50 @@ square(const T& param)
     return param*param;
 }
 
+// Calls a function when leaving the scope, also when unwinding from an exception
+template<typename F>
+class Scope_guard
+{
+  public:
+    explicit Scope_guard(F on_exit) : on_exit_{std::move(on_exit)} {}
+    ~Scope_guard() { on_exit_(); }
+
+    Scope_guard(const Scope_guard&) = delete;
+    Scope_guard& operator=(const Scope_guard&) = delete;
+
+  private:
+    F on_exit_;
+};
+
+// Scalar type model kernels compute in. Single precision halves memory traffic and doubles the SIMD width,
+// at an accuracy good enough to screen parameters before fitting in double precision.
+enum class Precision
+{
+    DOUBLE,
+    SINGLE
+};
+
+// Read-only view of contiguous values, a stand-in for C++20's std::span<const T>
+template<typename T>
+class Const_span
+{
+  public:
+    Const_span(const T* data, size_t size) : data_{data}, size_{size} {}
+    template<typename Allocator>
+    Const_span(const std::vector<T, Allocator>& values) : data_{values.data()}, size_{values.size()} {}
+
+    const T* begin() const { return data_; }
+    const T* end() const { return data_ + size_; }
+    const T* data() const { return data_; }
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    const T& operator[](size_t index) const { return data_[index]; }
+
+  private:
+    const T* data_;
+    size_t size_;
+};
+
 template<typename T>
 T typesafe_voidptr_cast(void* data)
 {
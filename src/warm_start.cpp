@@ -0,0 +1,233 @@
+/*
+ *  This file is part of Lime, a tool for the application of Likhtman & McLiesh' model for polymer dyanmics.
+ *
+ *  Copyright © 2020 Daniel Emmery (CNRS)
+ *
+ *  File contents:
+ *
+ *  Store of converged fits, used as initial guesses for later fits
+ *
+ *  GPL 3.0 License
+ *
+ */
+
+#include "warm_start.hpp"
+#include "lime_log_utils.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+
+std::string
+Warm_start_key::fingerprint_file(const std::filesystem::path& path, size_t column)
+{
+    std::ifstream file(path, std::ios::binary);
+
+    if (not file)
+    {
+        throw std::runtime_error("Could not open " + path.string() + " to fingerprint it.");
+    }
+
+    // 64 bit FNV-1a
+    std::uint64_t hash = 14695981039346656037ull;
+
+    auto add = [&hash](unsigned char byte) {
+        hash ^= byte;
+        hash *= 1099511628211ull;
+    };
+
+    std::istreambuf_iterator<char> begin(file), end;
+    std::for_each(begin, end, [&add](char byte) { add(static_cast<unsigned char>(byte)); });
+
+    for (size_t i = 0 ; i < sizeof(column) ; ++i)
+    {
+        add(static_cast<unsigned char>(column >> (8*i)));
+    }
+
+    std::stringstream out;
+    out << std::hex << std::setw(16) << std::setfill('0') << hash;
+    return out.str();
+}
+
+bool
+Warm_start_key::same_model(const Warm_start_key& other) const
+{
+    return cr_impl == other.cr_impl and c_v == other.c_v and decouple == other.decouple;
+}
+
+std::istream&
+operator>>(std::istream& stream, Warm_start_store::Record& record)
+{
+    int impl;
+
+    stream >> record.key.fingerprint >> record.key.N >> impl >> record.key.c_v >> record.key.decouple
+           >> record.values.N_e >> record.values.tau_monomer >> record.values.G_e;
+
+    record.key.cr_impl = static_cast<constraint_release::impl>(impl);
+
+    return stream;
+}
+
+std::ostream&
+operator<<(std::ostream& stream, const Warm_start_store::Record& record)
+{
+    return stream << std::setprecision(std::numeric_limits<double>::max_digits10)
+                  << record.key.fingerprint << ' ' << record.key.N << ' ' << static_cast<int>(record.key.cr_impl) << ' '
+                  << record.key.c_v << ' ' << record.key.decouple << ' '
+                  << record.values.N_e << ' ' << record.values.tau_monomer << ' ' << record.values.G_e;
+}
+
+Warm_start_store::Warm_start_store(std::filesystem::path path)
+:   path_{path}, records_{}
+{
+    std::ifstream file(path_);
+
+    // Nothing stored yet
+    if (not file)
+    {
+        return;
+    }
+
+    std::string line;
+    size_t line_number{0};
+
+    while (std::getline(file, line))
+    {
+        ++line_number;
+
+        if (line.empty() or line.front() == '#')
+        {
+            continue;
+        }
+
+        std::istringstream stream(line);
+        Record record;
+
+        if (stream >> record)
+        {
+            records_.push_back(record);
+        }
+        else
+        {
+            BOOST_LOG_TRIVIAL(warning) << "Skipping unreadable line " << line_number << " of warm start store " << path_;
+        }
+    }
+}
+
+std::optional<Warm_start_values>
+Warm_start_store::lookup(const Warm_start_key& key) const
+{
+    std::vector<const Record*> candidates;
+
+    for (const auto& record : records_)
+    {
+        if (record.key.same_model(key) and record.key.fingerprint == key.fingerprint)
+        {
+            candidates.push_back(&record);
+        }
+    }
+
+    if (candidates.empty())
+    {
+        for (const auto& record : records_)
+        {
+            if (record.key.same_model(key))
+            {
+                candidates.push_back(&record);
+            }
+        }
+    }
+
+    // Nearest chain length on either side, later records win ties
+    const Record* lower{nullptr};
+    const Record* upper{nullptr};
+
+    for (const auto candidate : candidates)
+    {
+        if (candidate->key.N <= key.N and (not lower or candidate->key.N >= lower->key.N))
+        {
+            lower = candidate;
+        }
+
+        if (candidate->key.N >= key.N and (not upper or candidate->key.N <= upper->key.N))
+        {
+            upper = candidate;
+        }
+    }
+
+    if (not lower and not upper)
+    {
+        return std::nullopt;
+    }
+    else if (not lower or not upper or lower->key.N == upper->key.N)
+    {
+        return lower ? lower->values : upper->values;
+    }
+
+    const double w = std::log(key.N / lower->key.N) / std::log(upper->key.N / lower->key.N);
+
+    auto interpolate = [w](double a, double b) {
+        if (a > 0.0 and b > 0.0)
+        {
+            return std::exp((1.0 - w) * std::log(a) + w * std::log(b));
+        }
+
+        return (1.0 - w) * a + w * b;
+    };
+
+    return Warm_start_values{
+        interpolate(lower->values.N_e, upper->values.N_e),
+        interpolate(lower->values.tau_monomer, upper->values.tau_monomer),
+        interpolate(lower->values.G_e, upper->values.G_e)
+    };
+}
+
+void
+Warm_start_store::record(const Warm_start_key& key, const Warm_start_values& values)
+{
+    auto same = std::find_if(records_.begin(), records_.end(), [&key](const Record& record) {
+        return record.key.same_model(key) and record.key.fingerprint == key.fingerprint and record.key.N == key.N;
+    });
+
+    if (same != records_.end())
+    {
+        same->values = values;
+    }
+    else
+    {
+        records_.push_back(Record{key, values});
+    }
+
+    save();
+}
+
+void
+Warm_start_store::save() const
+{
+    // Write a copy and move it in place, so an interrupted write can't corrupt the store
+    auto temporary = path_;
+    temporary += ".tmp";
+
+    {
+        std::ofstream file(temporary);
+
+        if (not file)
+        {
+            throw std::runtime_error("Could not write warm start store " + temporary.string());
+        }
+
+        file << "# fingerprint N cr_impl c_v decouple N_e tau_monomer G_e\n";
+
+        for (const auto& record : records_)
+        {
+            file << record << '\n';
+        }
+    }
+
+    std::filesystem::rename(temporary, path_);
+}
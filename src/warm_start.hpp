@@ -0,0 +1,74 @@
+#pragma once
+
+/*
+ *  This file is part of Lime, a tool for the application of Likhtman & McLiesh' model for polymer dyanmics.
+ *
+ *  Copyright © 2020 Daniel Emmery (CNRS)
+ *
+ *  File contents:
+ *
+ *  Store of converged fits, used as initial guesses for later fits
+ *
+ *  GPL 3.0 License
+ *
+ */
+
+#include "constraint_release/constraint_release.hpp"
+
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <vector>
+#include <iosfwd>
+
+// Identifies the data and the model configuration of a fit
+struct Warm_start_key
+{
+    // Of the input file and the selected column
+    std::string fingerprint;
+    double N;
+    constraint_release::impl cr_impl;
+    double c_v;
+    bool decouple;
+
+    static std::string fingerprint_file(const std::filesystem::path& path, size_t column);
+
+    // Same model configuration, regardless of data and chain length
+    bool same_model(const Warm_start_key& other) const;
+};
+
+struct Warm_start_values
+{
+    double N_e;
+    double tau_monomer;
+    double G_e;
+};
+
+// Plain text file with one converged fit per line
+class Warm_start_store
+{
+    public:
+        explicit Warm_start_store(std::filesystem::path path);
+
+        // Fits of the same model on the same data are preferred over fits on other data. Between the chain lengths
+        // on either side of N the values are interpolated in log-log space, outside of them the nearest is used.
+        std::optional<Warm_start_values> lookup(const Warm_start_key& key) const;
+
+        // Replaces the fit with the same key if there is one, and writes the store
+        void record(const Warm_start_key& key, const Warm_start_values& values);
+
+    private:
+        struct Record
+        {
+            Warm_start_key key;
+            Warm_start_values values;
+        };
+
+        std::filesystem::path path_;
+        std::vector<Record> records_;
+
+        void save() const;
+
+        friend std::istream& operator>>(std::istream& stream, Record& record);
+        friend std::ostream& operator<<(std::ostream& stream, const Record& record);
+};
@@ -11,8 +11,10 @@
 
 #include "../src/constraint_release/constraint_release.hpp"
 #include "../src/constraint_release/heuzey.hpp"
+#include "../src/constraint_release/doublereptation.hpp"
 #include "../src/constraint_release/rubinsteincolby.hpp"
 #include "../src/time_series.hpp"
+#include "../src/log_grid.hpp"
 #include "../src/file_reader.hpp"
 #include "../src/postprocess.hpp"
 
@@ -24,14 +26,36 @@
 #include "../src/checks.hpp"
 #include "../src/tube.hpp"
 
+/// Fitting
+
+#include "../src/parameter_transform.hpp"
+#include "../src/result.hpp"
+#include "../src/fit_large.hpp"
+#include "../src/fit_multistart.hpp"
+#include "../src/fit_portfolio.hpp"
+#include "../src/fit_bootstrap.hpp"
+#include "../src/fit_joint.hpp"
+#include "../src/warm_start.hpp"
+#include "../src/checkpoint.hpp"
+#include "../src/sampler.hpp"
+#include "../src/surrogate.hpp"
+#include "../src/buffer_pool.hpp"
+#include "../src/error_channel.hpp"
+#include "../src/autotune.hpp"
+#include "../src/batch.hpp"
+#include "../src/parallel_policy.hpp"
+
 #include <array>
 #include <numeric>
 #include <filesystem>
 #include <algorithm>
 #include <memory>
+#include <thread>
+#include <chrono>
 
 static Register_class<IConstraint_release, RUB_constraint_release, constraint_release::impl, double, Context&> rubinstein_constraint_release_factory(constraint_release::impl::RUBINSTEINCOLBY);
 static Register_class<IConstraint_release, HEU_constraint_release, constraint_release::impl, double, Context&> heuzey_constraint_release_factory(constraint_release::impl::HEUZEY);
+static Register_class<IConstraint_release, DR_constraint_release, constraint_release::impl, double, Context&> dr_constraint_release_factory(constraint_release::impl::DOUBLEREPTATION);
 
 struct Reproduction_context {
 	using path_impl_pair = std::pair<std::filesystem::path, constraint_release::impl>;
@@ -410,4 +434,1134 @@ BOOST_AUTO_TEST_CASE(
 
     BOOST_REQUIRE_THROW( (check<tuple_t, zero<throws>>(tuple)), std::runtime_error );
     BOOST_REQUIRE_THROW( (check<tuple_t, is_nan<throws>>(tuple)), std::runtime_error );
-}
\ No newline at end of file
+}
+
+BOOST_AUTO_TEST_CASE(
+    time_series_expressions,
+    * boost::unit_test::label("time_series"))
+{
+    auto time = Time_range::construct(4);
+    std::iota(time->begin(), time->end(), 1.0);
+
+    Time_series a(time, {1.0, 2.0, 3.0, 4.0});
+    Time_series b(time, {2.0, 2.0, 2.0, 2.0});
+    Time_series c(Time_range::convert(*time), {1.0, 1.0, 1.0, 1.0});
+
+    // A grid equal by value combines like the same grid
+    Time_series fused = a * b * 0.5 + c;
+
+    BOOST_TEST(fused.get_time_range() == time);
+    BOOST_TEST(fused.get_values() == Time_series::value_type({2.0, 3.0, 4.0, 5.0}), boost::test_tools::per_element());
+
+    // Assigning an expression that refers to the target
+    fused = 2.0 * fused * a;
+    BOOST_TEST(fused.get_values() == Time_series::value_type({4.0, 12.0, 24.0, 40.0}), boost::test_tools::per_element());
+
+    Time_series shifted(Time_range::construct(4), {1.0, 1.0, 1.0, 1.0});
+    BOOST_CHECK_THROW(a + shifted, std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE(
+    time_series_move_and_views,
+    * boost::unit_test::label("time_series"))
+{
+    auto time = Time_range::construct(3);
+    std::iota(time->begin(), time->end(), 1.0);
+
+    Time_series series(time, {1.0, 2.0, 3.0});
+
+    const auto view = series.values();
+    BOOST_TEST(view.size() == 3u);
+    BOOST_TEST(view[2] == 3.0);
+    BOOST_TEST(series.times().data() == time->data());
+
+    // Moving hands over the storage, views stay valid
+    Time_series moved(std::move(series));
+    BOOST_TEST(moved.values().data() == view.data());
+
+    Time_series assigned(time);
+    assigned = std::move(moved);
+    BOOST_TEST(assigned.values().data() == view.data());
+
+    BOOST_CHECK_CLOSE(RMSE<double>(assigned.values(), Time_series::value_type{1.0, 2.0, 5.0}), std::sqrt(4.0/3.0), 1e-8);
+}
+
+BOOST_AUTO_TEST_CASE(
+    execution_context_limits,
+    * boost::unit_test::label("time_series"))
+{
+    auto& context = Execution_context::get();
+    const size_t threshold = context.sequential_threshold();
+
+    context.set_num_threads(1);
+    BOOST_TEST(context.num_threads() == 1u);
+    BOOST_TEST(not context.parallel(1u << 20));
+
+    context.set_num_threads(0);
+    BOOST_TEST(context.num_threads() >= 1u);
+    BOOST_TEST(context.parallel(threshold));
+    BOOST_TEST(not context.parallel(threshold - 1));
+
+    // Results don't depend on the policy chosen
+    std::vector<double> values(2 * threshold, 1.0);
+
+    auto sum = [&values](const auto& policy) {
+        return std::reduce(policy, values.begin(), values.end(), 0.0);
+    };
+
+    BOOST_TEST(with_policy(values.size(), sum) == with_policy(1, sum));
+}
+
+BOOST_AUTO_TEST_CASE(
+    autotuner_strategies,
+    * boost::unit_test::label("time_series"))
+{
+    // Cheap terms on short grids aren't worth a thread
+    BOOST_TEST((decide_strategy(1e-7, 60, 0, 64).strategy == Kernel_strategy::SEQUENTIAL));
+    BOOST_TEST((decide_strategy(1.0, 1000, 0, 1).strategy == Kernel_strategy::SEQUENTIAL));
+
+    // Expensive points with realizations to spare are split within, fewer threads than points split over time
+    const auto inner = decide_strategy(1.0, 10, 1000, 64);
+    BOOST_TEST((inner.strategy == Kernel_strategy::OVER_INNER));
+    BOOST_TEST(inner.chunk == 4u);
+    BOOST_TEST((decide_strategy(1.0, 100, 1000, 64).strategy == Kernel_strategy::OVER_TIME));
+
+    // A point that splits its work per quadrature node is only split within if every node is worth it
+    BOOST_TEST((decide_strategy(1.0, 10, 1000, 64, 1000.0).strategy == Kernel_strategy::OVER_TIME));
+    BOOST_TEST((decide_strategy(1.0, 10, 1000, 64, 10.0).strategy == Kernel_strategy::OVER_INNER));
+
+    // Chunks hold enough work per task, and leave enough tasks per thread
+    BOOST_TEST(decide_strategy(std::ldexp(1.0, -20), 100000, 0, 4).chunk == 525u);
+    BOOST_TEST(decide_strategy(std::ldexp(1.0, -20), 1000, 0, 4).chunk == 62u);
+
+    auto& tuner = Autotuner::get();
+    tuner.reset();
+
+    std::vector<double> input(5000);
+    std::iota(input.begin(), input.end(), 0.0);
+    std::vector<double> output(input.size());
+
+    static const Kernel_id square_kernel{"test_square"};
+
+    // An empty first range measures nothing, and mustn't keep the kernel from being probed later
+    tuned_transform(square_kernel, input.begin(), input.begin(), output.begin(), [](double x) { return x * x; });
+    BOOST_TEST(not tuner.cost("test_square").has_value());
+
+    tuned_transform(square_kernel, input.begin(), input.end(), output.begin(), [](double x) { return x * x; });
+
+    BOOST_TEST(tuner.cost("test_square").has_value());
+    BOOST_TEST(output[4999] == 4999.0 * 4999.0);
+    BOOST_TEST(output[0] == 0.0);
+
+    tuner.reset();
+}
+
+BOOST_AUTO_TEST_CASE(
+    buffer_pool_recycling,
+    * boost::unit_test::label("time_series"))
+{
+    auto time = Time_range::construct(100);
+    std::iota(time->begin(), time->end(), 1.0);
+
+    Buffer_pool::set_enabled(true);
+
+    const auto before = Buffer_pool::statistics();
+    const Time_series::value_primitive* storage;
+
+    {
+        Time_series series(time);
+        storage = series.values().data();
+        BOOST_TEST(reinterpret_cast<std::uintptr_t>(storage) % Buffer_pool::alignment == 0u);
+    }
+
+    // A series on the same grid gets the buffer just freed
+    {
+        Time_series series(time);
+        BOOST_TEST(series.values().data() == storage);
+    }
+
+    Buffer_pool::set_enabled(false);
+    BOOST_TEST(not Buffer_pool::enabled());
+
+    // Scopes enable the pool until the last of them ends
+    {
+        Buffer_pool::Scope outer;
+        {
+            Buffer_pool::Scope inner;
+        }
+        BOOST_TEST(Buffer_pool::enabled());
+    }
+    BOOST_TEST(not Buffer_pool::enabled());
+
+#ifdef POOL_STATISTICS
+    const auto after = Buffer_pool::statistics();
+    BOOST_TEST(after.reused - before.reused >= 1u);
+    BOOST_TEST(after.released - before.released >= 2u);
+#else
+    (void)before;
+#endif
+}
+
+BOOST_AUTO_TEST_CASE(
+    time_grid_interning,
+    * boost::unit_test::label("time_series"))
+{
+    auto& registry = Time_grid_registry::get();
+
+    // Equal grids are shared, whichever way they were made
+    const auto generated = Time_range::generate_exponential(1.5, 1e4);
+    BOOST_TEST(Time_range::generate_exponential(1.5, 1e4) == generated);
+    BOOST_TEST(Time_range::convert(*generated) == generated);
+
+    const auto info = registry.info(generated);
+    BOOST_REQUIRE(info);
+    BOOST_TEST(info->base == 1.5);
+    BOOST_TEST(info->max == 1e4);
+    BOOST_TEST(info->norm == 1.0);
+    BOOST_TEST(info->hash == Time_grid_registry::hash(*generated));
+
+    const auto normalized = Time_range::generate_normalized_exponential(1.5, 1e4, 2.0);
+    BOOST_TEST(normalized != generated);
+    BOOST_TEST(registry.info(normalized)->id != info->id);
+    BOOST_TEST(not registry.compatible(generated, normalized));
+
+    // Grids that aren't interned are compared by their time points
+    const auto copy = std::make_shared<Time_range::base>(*generated);
+    BOOST_TEST(not registry.info(copy));
+    BOOST_TEST(registry.compatible(generated, copy));
+
+    // A grid converted before it is generated gets its parameters from the generator
+    const auto grid = Log_grid::exponential(1.3, 1e4);
+    const auto converted = Time_range::convert(*grid.chunk(0, grid.size()));
+    BOOST_TEST(std::isnan(registry.info(converted)->base));
+    BOOST_TEST(Time_range::generate_exponential(1.3, 1e4) == converted);
+    BOOST_TEST(registry.info(converted)->base == 1.3);
+    BOOST_TEST(registry.info(converted)->max == 1e4);
+    BOOST_TEST(registry.info(converted)->norm == 1.0);
+}
+
+BOOST_AUTO_TEST_CASE(
+    log_grid_points_and_lookup,
+    * boost::unit_test::label("time_series"))
+{
+    const auto grid = Log_grid::exponential(1.2, 1e5, 4.0);
+    const auto time = Time_range::generate_normalized_exponential(1.2, 1e5, 4.0);
+
+    BOOST_REQUIRE(grid.size() == time->size());
+
+    for (size_t i = 0 ; i < grid.size() ; ++i)
+        BOOST_TEST(grid[i] == (*time)[i]);
+
+    BOOST_TEST(grid.materialize() == time);
+
+    for (size_t i = 0 ; i < grid.size() ; ++i)
+    {
+        BOOST_TEST(grid.index_of((*time)[i]) == i);
+
+        if (i + 1 < grid.size())
+            BOOST_TEST(grid.index_of(0.5 * ((*time)[i] + (*time)[i+1])) == i);
+    }
+
+    BOOST_TEST(grid.index_of(0.0) == 0u);
+    BOOST_TEST(grid.index_of(1e9) == grid.size() - 1);
+
+    // Chunks line up with the full grid
+    const auto chunk = grid.chunk(10, 20);
+    BOOST_TEST(*chunk == Time_range::base(time->begin() + 10, time->begin() + 20), boost::test_tools::per_element());
+
+    const auto detected = Log_grid::detect(*time);
+    BOOST_REQUIRE(detected);
+    BOOST_TEST(detected->size() == grid.size());
+    BOOST_TEST(detected->index_of((*time)[42]) == 42u);
+
+    BOOST_TEST(not Log_grid::detect(Time_range::base{1.0, 2.0, 3.0}));
+}
+
+BOOST_AUTO_TEST_CASE(
+    transform_round_trip,
+    * boost::unit_test::label("transform"))
+{
+    std::array<std::shared_ptr<const IParameter_transform>, 3> transforms{
+        std::make_shared<Identity_transform>(),
+        std::make_shared<Log_transform>(),
+        std::make_shared<Sigmoid_transform>(Bounds{1.0, 100.0})
+    };
+
+    for (const auto& transform : transforms)
+    {
+        for (double value : {2.0, 15.0, 99.0})
+        {
+            BOOST_TEST_INFO("value: " << value);
+            BOOST_CHECK_CLOSE(transform->to_external(transform->to_internal(value)), value, 1e-8);
+
+            // Compare chain rule factor to a central difference
+            const double internal = transform->to_internal(value);
+            const double h = 1e-6;
+            const double fd = (transform->to_external(internal + h) - transform->to_external(internal - h)) / (2.0*h);
+            BOOST_CHECK_CLOSE(transform->derivative(internal), fd, 1e-4);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(
+    transform_stays_valid,
+    * boost::unit_test::label("transform"))
+{
+    Log_transform log_transform;
+    Sigmoid_transform sigmoid_transform(Bounds{10.0, 20.0});
+
+    for (double internal : {-50.0, -1.0, 0.0, 1.0, 50.0})
+    {
+        BOOST_TEST(log_transform.to_external(internal) > 0.0);
+        BOOST_TEST(sigmoid_transform.to_external(internal) >= 10.0);
+        BOOST_TEST(sigmoid_transform.to_external(internal) <= 20.0);
+    }
+
+    BOOST_REQUIRE_THROW(log_transform.to_internal(-1.0), std::runtime_error);
+    BOOST_REQUIRE_THROW(sigmoid_transform.to_internal(30.0), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE(
+    transform_bounds_parse,
+    * boost::unit_test::label("transform"))
+{
+    std::stringstream in("2.5:40");
+    Bounds bounds;
+    in >> bounds;
+
+    BOOST_TEST(bounds.lower == 2.5);
+    BOOST_TEST(bounds.upper == 40.0);
+    BOOST_TEST(bounds.bounded());
+
+    std::stringstream reversed("40:2.5");
+    BOOST_REQUIRE_THROW(reversed >> bounds, std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE(
+    error_channel_first_error_wins,
+    * boost::unit_test::label("time_series"))
+{
+    std::vector<double> input(1000);
+    std::iota(input.begin(), input.end(), 0.0);
+    std::vector<double> output(input.size());
+
+    auto throwing = [](double value) -> double {
+        if (value >= 500.0)
+            throw std::runtime_error("element failed");
+        return 2.0 * value;
+    };
+
+    Error_channel errors;
+    std::transform(sync_exec_policy, input.begin(), input.end(), output.begin(), errors.guard(throwing));
+
+    BOOST_TEST(errors.failed());
+    BOOST_CHECK_THROW(errors.rethrow_if_failed(), std::runtime_error);
+
+    // A failure stays with its own invocation
+    Error_channel next;
+    std::transform(sync_exec_policy, input.begin(), input.begin() + 500, output.begin(), next.guard(throwing));
+
+    BOOST_TEST(not next.failed());
+    BOOST_CHECK_NO_THROW(next.rethrow_if_failed());
+    BOOST_TEST(output[499] == 998.0);
+
+    // Point-wise derivatives hand the error of a point to the caller
+    const auto time = Time_range::generate_exponential(1.5, 1e4);
+    BOOST_CHECK_THROW(derivative([](double t) -> double {
+        if (t > 100.0)
+            throw std::runtime_error("point failed");
+        return t;
+    }, time), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE(
+    result_chunked_calculate,
+    * boost::unit_test::label("result")
+    * boost::unit_test::label("heuzey"))
+{
+    auto system = std::make_shared<System>();
+    system->T = 1.0;
+    system->rho = 1.0;
+
+    auto ctx = std::make_shared<Context>();
+    ctx->N = 100;
+    ctx->N_e = 10;
+    ctx->tau_monomer = 1;
+
+    ICS_context_builder builder(system, ctx);
+    ICS_result result(Time_range::generate_exponential(1.2, 1e5), &builder, constraint_release::impl::HEUZEY);
+    result.calculate();
+
+    const auto expected = result.get_values();
+    const size_t chunk_size = 7;
+    std::vector<double> chunk(chunk_size);
+
+    for (size_t first = 0 ; first < result.size() ; first += chunk_size)
+    {
+        const size_t last = std::min(first + chunk_size, result.size());
+        result.calculate(first, last, chunk.data());
+
+        for (size_t j = first ; j < last ; ++j)
+        {
+            BOOST_TEST(chunk[j - first] == expected[j]);
+        }
+    }
+
+    BOOST_REQUIRE_THROW(result.calculate(0, result.size() + 1, chunk.data()), std::out_of_range);
+}
+
+BOOST_AUTO_TEST_CASE(
+    batch_matches_results,
+    * boost::unit_test::label("result")
+    * boost::unit_test::label("heuzey"))
+{
+    auto system = std::make_shared<System>();
+    system->T = 1.0;
+    system->rho = 1.0;
+
+    // Two time blocks and two groups of lanes, the last one partly filled, with chain lengths for every Heuzey model
+    const auto time = Time_range::generate_exponential(1.1, 1e5);
+    const double c_v = 0.1;
+
+    for (auto impl : {constraint_release::impl::HEUZEY, constraint_release::impl::DOUBLEREPTATION})
+    {
+        Parameter_batch batch;
+        std::vector<Time_series::value_type> expected;
+
+        for (size_t i = 0 ; i < 9 ; ++i)
+        {
+            auto ctx = std::make_shared<Context>();
+            ctx->N = 40.0 + 455.0 * static_cast<double>(i);
+            ctx->N_e = 10;
+            ctx->tau_monomer = 1;
+
+            ICS_context_builder builder(system, ctx);
+            ICS_result result(time, &builder, impl);
+            result.CR->c_v_ = c_v;
+            result.calculate();
+
+            expected.push_back(result.get_values());
+            batch.push_back(*ctx, c_v);
+        }
+
+        const Batch_evaluator evaluator(time, impl);
+        const auto values = evaluator.evaluate(batch);
+
+        BOOST_REQUIRE(values.size() == batch.size() * time->size());
+
+        for (size_t k = 0 ; k < batch.size() ; ++k)
+            for (size_t j = 0 ; j < time->size() ; ++j)
+                BOOST_CHECK_CLOSE(values[k * time->size() + j], expected[k][j], 1e-5);
+    }
+
+    BOOST_CHECK_THROW(Batch_evaluator(time, constraint_release::impl::RUBINSTEINCOLBY), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE(
+    single_precision_error_bound,
+    * boost::unit_test::label("result")
+    * boost::unit_test::label("precision"))
+{
+    auto system = std::make_shared<System>();
+    system->T = 1.0;
+    system->rho = 1.0;
+
+    auto ctx = std::make_shared<Context>();
+    ctx->N = 100;
+    ctx->N_e = 10;
+    ctx->tau_monomer = 1;
+
+    ICS_context_builder builder(system, ctx);
+    ICS_result result(Time_range::generate_exponential(1.5, 1e6), &builder, constraint_release::impl::RUBINSTEINCOLBY);
+    result.calculate();
+
+    const auto reference = result.get_values();
+
+    // Same spectrum, rounded to float
+    result.CR->set_precision(Precision::SINGLE);
+    result.calculate();
+
+    // Rounding the spectrum shifts G(t) by a small absolute amount, which grows relative to G(t) as it decays
+    double max_error{0.0};
+    double max_relative_error{0.0};
+
+    for (size_t i = 0 ; i < reference.size() ; ++i)
+    {
+        const double error = std::abs(result.values()[i] - reference[i]);
+        max_error = std::max(max_error, error / reference.front());
+        max_relative_error = std::max(max_relative_error, error / reference[i]);
+    }
+
+    BOOST_TEST_MESSAGE("Single precision error: " << max_error << " of G(0), " << max_relative_error << " of G(t)");
+    BOOST_TEST(max_error < 1e-3);
+    BOOST_TEST(max_relative_error < 5e-2);
+
+    result.CR->set_precision(Precision::DOUBLE);
+    result.calculate();
+
+    BOOST_TEST(result.get_values() == reference, boost::test_tools::per_element());
+}
+
+BOOST_AUTO_TEST_CASE(
+    time_range_log_decimate,
+    * boost::unit_test::label("time_series"))
+{
+    auto time = Time_range::generate_exponential(1.01, 1e6);
+    const auto indices = Time_range::log_decimate(*time, 10);
+
+    // 6 decades at 10 points each, plus the last point
+    BOOST_TEST(indices.size() <= 61u);
+    BOOST_TEST(indices.size() >= 59u);
+    BOOST_TEST(indices.front() == 0u);
+    BOOST_TEST(indices.back() == time->size() - 1);
+    BOOST_TEST(std::is_sorted(indices.begin(), indices.end()));
+
+    const auto all = Time_range::log_decimate(Time_range::base{0.0, 1.0, 10.0, 100.0}, 1);
+    BOOST_TEST(all.size() == 4u);
+
+    BOOST_REQUIRE_THROW(Time_range::log_decimate(*time, 0), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE(
+    fit_fvv_second_derivative,
+    * boost::unit_test::label("fit")
+    * boost::unit_test::label("heuzey"))
+{
+    auto system = std::make_shared<System>();
+    system->T = 1.0;
+    system->rho = 1.0;
+
+    auto ctx = std::make_shared<Context>();
+    ctx->N = 100;
+    ctx->N_e = 10;
+    ctx->tau_monomer = 1;
+    ctx->G_e = 1.0;
+
+    ICS_decoupled_context_builder builder(system, ctx);
+    ICS_result result(Time_range::generate_exponential(1.5, 1e5), &builder, constraint_release::impl::HEUZEY);
+    result.calculate();
+
+    const size_t n = result.size();
+    Time_series::value_type data(n);
+    std::transform(result.cbegin(), result.cend(), data.begin(), [](double g){ return 2.0 * g; });
+
+    using Fit_G_e = Fit<double>;
+
+    Fit_G_e fit(ctx->G_e);
+    fit.use_log_transform();
+
+    std::vector<double> weights(n);
+    std::transform(data.begin(), data.end(), weights.begin(), [](double y){ return std::pow(y, 1.2); });
+
+    gsl_vector* x_step = gsl_vector_alloc(1);
+    gsl_vector* f_step = gsl_vector_alloc(n);
+    gsl_vector* fvv = gsl_vector_alloc(n);
+
+    Fit_G_e::User_data userdata{&data, &fit.free_variables, &fit.transforms, &result, weights.data(), nullptr, nullptr, x_step, f_step, nullptr};
+
+    gsl_multifit_nlinear_fdf function{};
+    function.f = &Fit_G_e::fit_func;
+    function.fvv = &Fit_G_e::fit_fvv;
+    function.n = n;
+    function.p = 1;
+    function.params = &userdata;
+
+    gsl_multifit_nlinear_workspace* workspace = gsl_multifit_nlinear_alloc(gsl_multifit_nlinear_trust, &fit.fdf_params, n, 1);
+    userdata.workspace = workspace;
+
+    // G_e = exp(u), so the residuals 1 - exp(u) g_j/y_j have the second derivative -exp(u) g_j/y_j = -3/2 at u = log(3)
+    double x_init[1] = {std::log(3.0)};
+    double v_init[1] = {1.0};
+    gsl_vector_view x = gsl_vector_view_array(x_init, 1);
+    gsl_vector_view v = gsl_vector_view_array(v_init, 1);
+    gsl_vector_view wts = gsl_vector_view_array(weights.data(), n);
+
+    BOOST_REQUIRE(gsl_multifit_nlinear_winit(&x.vector, &wts.vector, &function, workspace) == GSL_SUCCESS);
+    BOOST_REQUIRE(Fit_G_e::fit_fvv(&x.vector, &v.vector, &userdata, fvv) == GSL_SUCCESS);
+
+    // The one-sided difference is accurate to O(h_fvv)
+    for (size_t j = 0 ; j < n ; ++j)
+        BOOST_CHECK_CLOSE(gsl_vector_get(fvv, j), -1.5, 1.0);
+
+    gsl_multifit_nlinear_free(workspace);
+    gsl_vector_free(fvv);
+    gsl_vector_free(f_step);
+    gsl_vector_free(x_step);
+}
+
+BOOST_AUTO_TEST_CASE(
+    fit_linear_scale_closed_form,
+    * boost::unit_test::label("fit")
+    * boost::unit_test::label("heuzey"))
+{
+    auto system = std::make_shared<System>();
+    system->T = 1.0;
+    system->rho = 1.0;
+
+    auto ctx = std::make_shared<Context>();
+    ctx->N = 100;
+    ctx->N_e = 10;
+    ctx->tau_monomer = 1;
+    ctx->G_e = 1.0;
+
+    ICS_decoupled_context_builder builder(system, ctx);
+    ICS_result result(Time_range::generate_exponential(1.5, 1e5), &builder, constraint_release::impl::HEUZEY);
+    result.calculate();
+
+    // Synthetic data with a known G_e, weighted unevenly
+    const double known_G_e = 3.5;
+    Time_series::value_type data(result.size());
+    std::transform(result.cbegin(), result.cend(), data.begin(), [known_G_e](double g){ return known_G_e * g; });
+
+    std::vector<double> weights(data.size());
+    std::transform(data.begin(), data.end(), weights.begin(), [](double y){ return std::pow(y, 1.2); });
+
+    using Fit_N_e = Fit<double>;
+
+    Fit_N_e fit(ctx->N_e);
+    fit.eliminate_linear_scale(ctx->G_e);
+
+    Fit_N_e::User_data userdata{&data, &fit.free_variables, &fit.transforms, &result, weights.data(), &ctx->G_e, nullptr, nullptr, nullptr, nullptr};
+
+    Fit_N_e::solve_linear_scale(userdata);
+
+    BOOST_CHECK_CLOSE(ctx->G_e, known_G_e, 1e-10);
+
+    // The result is scaled in place and matches the data
+    for (size_t j = 0 ; j < data.size() ; ++j)
+        BOOST_CHECK_CLOSE(result.get_values()[j], data[j], 1e-10);
+}
+
+BOOST_AUTO_TEST_CASE(
+    large_fit_recovers_parameters,
+    * boost::unit_test::label("fit")
+    * boost::unit_test::label("heuzey"))
+{
+    auto system = std::make_shared<System>();
+    system->T = 1.0;
+    system->rho = 1.0;
+
+    auto ctx = std::make_shared<Context>();
+    ctx->N = 100;
+    ctx->N_e = 8;
+    ctx->tau_monomer = 1;
+
+    ICS_context_builder builder(system, ctx);
+    ICS_result result(Time_range::generate_exponential(1.2, 1e5), &builder, constraint_release::impl::HEUZEY);
+    result.calculate();
+
+    const auto data = result.get_values();
+
+    // A single chunk reuses its Jacobian, several chunks recompute theirs, both reach the same solution
+    for (size_t chunk_size : {size_t{1} << 16, size_t{7}})
+    {
+        ctx->N_e = 9;
+
+        Large_fit<double> fit(ctx->N_e);
+        fit.use_log_transform();
+        fit.chunk_size = chunk_size;
+        fit.callback_func = nullptr;
+
+        // Unit weights, the relative residuals are then of order one
+        fit.fit(data, result, 0.0);
+
+        BOOST_TEST(fit.converged);
+        BOOST_CHECK_CLOSE(ctx->N_e, 8.0, 1e-3);
+        BOOST_TEST(std::isfinite(fit.standard_errors[0]));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(
+    multistart_latin_hypercube,
+    * boost::unit_test::label("multistart"))
+{
+    const std::array<Bounds, 2> bounds{Bounds{1.0, 100.0}, Bounds{-1.0, 1.0}};
+    const size_t count = 20;
+
+    const auto points = sample_starts(bounds, count, Sampling::LATIN_HYPERCUBE, 42);
+
+    BOOST_REQUIRE(points.size() == count);
+
+    // Exactly one point per stratum, logarithmic for positive bounds
+    std::vector<size_t> log_strata, linear_strata;
+
+    for (const auto& point : points)
+    {
+        BOOST_TEST(bounds[0].contains(point[0]));
+        BOOST_TEST(bounds[1].contains(point[1]));
+
+        log_strata.push_back(static_cast<size_t>(std::log10(point[0]) / 2.0 * count));
+        linear_strata.push_back(static_cast<size_t>((point[1] + 1.0) / 2.0 * count));
+    }
+
+    std::sort(log_strata.begin(), log_strata.end());
+    std::sort(linear_strata.begin(), linear_strata.end());
+
+    for (size_t i = 0 ; i < count ; ++i)
+    {
+        BOOST_TEST(log_strata[i] == i);
+        BOOST_TEST(linear_strata[i] == i);
+    }
+
+    for (const auto& point : sample_starts(bounds, count, Sampling::SOBOL))
+    {
+        BOOST_TEST(bounds[0].contains(point[0]));
+        BOOST_TEST(bounds[1].contains(point[1]));
+    }
+
+    BOOST_REQUIRE_THROW(sample_starts(std::array<Bounds, 1>{Bounds{}}, count, Sampling::LATIN_HYPERCUBE), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE(
+    multistart_cluster_minima,
+    * boost::unit_test::label("multistart"))
+{
+    using Result = Start_result<2>;
+
+    std::vector<Result> results{
+        Result{{0.0, 0.0}, {10.0, 1.0}, 1.0, false},
+        Result{{0.0, 0.0}, {10.1, 1.01}, 1.1, false},
+        Result{{0.0, 0.0}, {20.0, 1.0}, 2.0, false},
+        Result{{0.0, 0.0}, {30.0, 3.0}, 50.0, true},
+        Result{{0.0, 0.0}, {40.0, 4.0}, std::numeric_limits<double>::infinity(), false}
+    };
+
+    const auto minima = cluster_minima(results);
+
+    BOOST_REQUIRE(minima.size() == 2u);
+    BOOST_TEST(minima[0].solution[0] == 10.0);
+    BOOST_TEST(minima[0].starts == 2u);
+    BOOST_TEST(minima[1].solution[0] == 20.0);
+    BOOST_TEST(minima[1].starts == 1u);
+}
+
+BOOST_AUTO_TEST_CASE(
+    portfolio_first_converged_wins,
+    * boost::unit_test::label("portfolio"))
+{
+    const auto strategies = default_strategies();
+    std::atomic<size_t> stopped{0};
+
+    // Only strategy 0 converges, right away. It runs first even sequentially, and the others iterate until they are stopped
+    auto fit_strategy = [&stopped](size_t index, const std::function<bool(size_t, double)>& stop) {
+        if (index == 0)
+        {
+            return Strategy_outcome{true, 1.0};
+        }
+
+        for (size_t iteration = 0 ; not stop(iteration, 1.0) ; ++iteration)
+        {
+            std::this_thread::yield();
+        }
+
+        ++stopped;
+
+        return Strategy_outcome{false, 2.0};
+    };
+
+    BOOST_TEST(race_strategies(strategies, fit_strategy) == 0u);
+    BOOST_TEST(stopped.load() == strategies.size() - 1);
+
+    // Cancelled strategies that still found a cost, the lowest one is kept
+    auto cancelled = [](size_t index, const std::function<bool(size_t, double)>&) {
+        return Strategy_outcome{false, index == 1 ? 0.5 : 1.0};
+    };
+    BOOST_TEST(race_strategies(strategies, cancelled) == 1u);
+
+    auto never = [](size_t, const std::function<bool(size_t, double)>&) {
+        return Strategy_outcome{false, std::numeric_limits<double>::infinity()};
+    };
+    BOOST_REQUIRE_THROW(race_strategies(strategies, never), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE(
+    result_cancellation,
+    * boost::unit_test::label("result")
+    * boost::unit_test::label("heuzey"))
+{
+    auto system = std::make_shared<System>();
+    system->T = 1.0;
+    system->rho = 1.0;
+
+    auto ctx = std::make_shared<Context>();
+    ctx->N = 100;
+    ctx->N_e = 10;
+    ctx->tau_monomer = 1;
+
+    ICS_context_builder builder(system, ctx);
+    ICS_result result(Time_range::generate_exponential(1.2, 1e5), &builder, constraint_release::impl::HEUZEY);
+
+    auto token = std::make_shared<Cancellation_token>();
+    result.cancellation = token;
+
+    BOOST_CHECK_NO_THROW(result.calculate());
+
+    token->cancel();
+    BOOST_REQUIRE_THROW(result.calculate(), Cancelled);
+
+    // Values filled by a surrogate are cancelled all the same
+    result.surrogate = [](const Context&, Time_series::value_primitive*) { return true; };
+    BOOST_REQUIRE_THROW(result.calculate(), Cancelled);
+
+    // An exhausted budget cancels without an explicit request
+    BOOST_TEST(Cancellation_token(0.0).cancelled());
+    BOOST_TEST(not Cancellation_token(3600.0).cancelled());
+}
+
+BOOST_AUTO_TEST_CASE(
+    result_cancellation_during_calculate,
+    * boost::unit_test::label("result")
+    * boost::unit_test::label("rubinstein"))
+{
+    using clock = std::chrono::steady_clock;
+    using seconds = std::chrono::duration<double>;
+
+    auto system = std::make_shared<System>();
+    system->T = 1.0;
+    system->rho = 1.0;
+
+    auto ctx = std::make_shared<Context>();
+    ctx->N = 100;
+    ctx->N_e = 10;
+    ctx->tau_monomer = 1;
+
+    // Far fewer points than a block of the former between-block checks
+    ICS_context_builder builder(system, ctx);
+    ICS_result result(Time_range::generate_exponential(1.02, 1e6), &builder, constraint_release::impl::RUBINSTEINCOLBY);
+
+    const auto start = clock::now();
+    result.calculate();
+    const double uncancelled = seconds(clock::now() - start).count();
+
+    // The deadline passes while the points are being evaluated
+    result.cancellation = std::make_shared<Cancellation_token>(uncancelled / 20.0);
+
+    const auto cancelled_start = clock::now();
+    BOOST_REQUIRE_THROW(result.calculate(), Cancelled);
+    const double cancelled = seconds(clock::now() - cancelled_start).count();
+
+    BOOST_TEST(cancelled < uncancelled / 2.0);
+}
+
+BOOST_AUTO_TEST_CASE(
+    fit_cancelled_before_first_evaluation,
+    * boost::unit_test::label("fit")
+    * boost::unit_test::label("heuzey"))
+{
+    auto system = std::make_shared<System>();
+    system->T = 1.0;
+    system->rho = 1.0;
+
+    auto ctx = std::make_shared<Context>();
+    ctx->N = 100;
+    ctx->N_e = 10;
+    ctx->tau_monomer = 1;
+
+    ICS_context_builder builder(system, ctx);
+    ICS_result result(Time_range::generate_exponential(1.5, 1e5), &builder, constraint_release::impl::HEUZEY);
+
+    const Time_series::value_type data(result.size(), 1.0);
+
+    // The budget is spent before the fit starts, so the result isn't evaluated at all
+    Fit fit(ctx->N_e, ctx->tau_monomer);
+    fit.cancellation = std::make_shared<Cancellation_token>(0.0);
+    fit.fit(data, result);
+
+    BOOST_TEST(fit.cancelled);
+    BOOST_TEST(not fit.converged);
+    BOOST_TEST(not std::isfinite(fit.cost));
+    BOOST_TEST(ctx->N_e == 10.0);
+    BOOST_TEST(ctx->tau_monomer == 1.0);
+    BOOST_TEST(std::all_of(result.cbegin(), result.cend(), [](double value) { return value == 0.0; }));
+    BOOST_TEST(not result.cancellation);
+}
+
+BOOST_AUTO_TEST_CASE(
+    warm_start_store,
+    * boost::unit_test::label("warm_start"))
+{
+    const auto path = std::filesystem::temp_directory_path() / "lime_test_warm_start";
+    std::filesystem::remove(path);
+
+    const Warm_start_key key_10{"a", 10.0, constraint_release::impl::HEUZEY, 0.1, false};
+    const Warm_start_key key_1000{"a", 1000.0, constraint_release::impl::HEUZEY, 0.1, false};
+    const Warm_start_key key_100{"a", 100.0, constraint_release::impl::HEUZEY, 0.1, false};
+
+    {
+        Warm_start_store store(path);
+        BOOST_TEST(not store.lookup(key_100).has_value());
+
+        store.record(key_10, Warm_start_values{10.0, 1.0, 1.0});
+        store.record(key_1000, Warm_start_values{1000.0, 100.0, 1.0});
+    }
+
+    // Reloaded from disk, halfway in log N is halfway in log values
+    Warm_start_store store(path);
+    const auto interpolated = store.lookup(key_100);
+
+    BOOST_REQUIRE(interpolated.has_value());
+    BOOST_CHECK_CLOSE(interpolated->N_e, 100.0, 1e-8);
+    BOOST_CHECK_CLOSE(interpolated->tau_monomer, 10.0, 1e-8);
+
+    // Beyond the stored chain lengths the nearest is used, and other data falls back to the same model
+    Warm_start_key other_data = key_1000;
+    other_data.fingerprint = "b";
+    other_data.N = 5000.0;
+    BOOST_CHECK_CLOSE(store.lookup(other_data)->N_e, 1000.0, 1e-8);
+
+    Warm_start_key other_model = key_100;
+    other_model.decouple = true;
+    BOOST_TEST(not store.lookup(other_model).has_value());
+
+    std::filesystem::remove(path);
+}
+
+BOOST_AUTO_TEST_CASE(
+    fit_checkpoint_round_trip,
+    * boost::unit_test::label("checkpoint"))
+{
+    const auto path = std::filesystem::temp_directory_path() / "lime_test_checkpoint";
+    auto spectrum_path = path;
+    spectrum_path += " spectrum";
+
+    Fit_checkpoint{"abc", 12, 0.25, {8.5, 1.0/3.0, 1e6}, spectrum_path}.save(path);
+    Spectrum{42, 3, {1.0, 2.0, 3.0, 4.0, 5.0, 6.0}}.save(spectrum_path);
+
+    const auto checkpoint = Fit_checkpoint::load(path);
+
+    BOOST_TEST(checkpoint.fingerprint == "abc");
+    BOOST_TEST(checkpoint.iterations == 12u);
+    BOOST_TEST(checkpoint.cost == 0.25);
+    BOOST_TEST(checkpoint.parameters == std::vector<double>({8.5, 1.0/3.0, 1e6}), boost::test_tools::per_element());
+    BOOST_TEST(checkpoint.spectrum == spectrum_path);
+
+    const auto spectrum = Spectrum::load(checkpoint.spectrum);
+
+    BOOST_TEST(spectrum.seed == 42u);
+    BOOST_TEST(spectrum.realization_size == 3u);
+    BOOST_TEST(spectrum.values == std::vector<double>({1.0, 2.0, 3.0, 4.0, 5.0, 6.0}), boost::test_tools::per_element());
+
+    std::filesystem::remove(path);
+    std::filesystem::remove(spectrum_path);
+}
+
+BOOST_AUTO_TEST_CASE(
+    bootstrap_resampling,
+    * boost::unit_test::label("bootstrap"))
+{
+    const Time_series::value_type model{1.0, 0.5, 0.25, 0.125, 0.0625, 0.03125};
+    Time_series::value_type data(model);
+    std::transform(model.begin(), model.end(), data.begin(), [](double m) { return 1.1 * m; });
+
+    std::mt19937 generator(1);
+
+    // All ratios are equal, so every resampling gives back the data
+    for (auto resampling : {Resampling::RESIDUALS, Resampling::BLOCKS})
+    {
+        const auto resampled = resample(data, model, resampling, 0, generator);
+        BOOST_TEST(resampled == data, boost::test_tools::tolerance(1e-12) << boost::test_tools::per_element());
+    }
+
+    std::vector<double> values(101);
+    std::iota(values.begin(), values.end(), 0.0);
+    std::shuffle(values.begin(), values.end(), generator);
+
+    const auto interval = percentile_interval(values, 0.9);
+
+    BOOST_CHECK_CLOSE(interval.lower, 5.0, 1e-8);
+    BOOST_CHECK_CLOSE(interval.median, 50.0, 1e-8);
+    BOOST_CHECK_CLOSE(interval.upper, 95.0, 1e-8);
+
+    // Failed and cancelled replicates are left out of the intervals
+    std::vector<Start_result<1>> results{
+        {{1.0}, {2.0}, 1.0, false, true},
+        {{1.0}, {4.0}, 1.0, false, true},
+        {{1.0}, {100.0}, std::numeric_limits<double>::infinity(), false, false},
+        {{1.0}, {1.0}, 1.0, false, false}
+    };
+
+    BOOST_CHECK_CLOSE(bootstrap_intervals(results, 0.95)[0].median, 3.0, 1e-8);
+
+    // Every replicate draws from its own seed, so the draws don't depend on the order replicates are fit in
+    const Time_series::value_type noisy{1.2, 0.45, 0.3, 0.11, 0.07, 0.029};
+    const auto sum_replicate = [](const Time_series::value_type& resampled) {
+        return Start_result<1>{{0.0}, {std::accumulate(resampled.begin(), resampled.end(), 0.0)}, 1.0, false};
+    };
+
+    const auto first = run_bootstrap<1>(noisy, model, 8, Resampling::RESIDUALS, 0, sum_replicate, 3);
+    const auto second = run_bootstrap<1>(noisy, model, 8, Resampling::RESIDUALS, 0, sum_replicate, 3);
+
+    for (size_t i = 0 ; i < first.size() ; ++i)
+    {
+        BOOST_TEST(first[i].solution[0] == second[i].solution[0]);
+    }
+
+    BOOST_TEST(first[0].solution[0] != first[1].solution[0]);
+}
+
+BOOST_AUTO_TEST_CASE(
+    tempered_ensemble_gaussian,
+    * boost::unit_test::label("sampler"))
+{
+    using Point = Tempered_ensemble<2>::Point;
+
+    // Correlated Gaussian with unit variances, the stretch move is indifferent to the correlation
+    auto log_prior = [](const Point& x) { return std::abs(x[0]) < 20.0 and std::abs(x[1]) < 20.0 ? 0.0 : -std::numeric_limits<double>::infinity(); };
+    auto log_likelihood = [](size_t, const Point& x) {
+        const double rho = 0.9;
+        return -0.5 * (x[0]*x[0] - 2.0*rho*x[0]*x[1] + x[1]*x[1]) / (1.0 - rho*rho);
+    };
+
+    std::vector<Point> start(16, Point{1.0, 1.0});
+    std::mt19937 generator(3);
+    std::normal_distribution<double> ball(0.0, 0.1);
+    for (auto& point : start)
+        for (auto& x : point)
+            x += ball(generator);
+
+    Tempered_ensemble<2> ensemble(start, 3, 2.0, log_prior, log_likelihood, 7);
+
+    double sum{0.0}, sum_squares{0.0};
+    size_t count{0};
+
+    for (size_t step = 0 ; step < 3000 ; ++step)
+    {
+        ensemble.step();
+
+        if (step < 500)
+            continue;
+
+        for (size_t k = 0 ; k < ensemble.walkers() ; ++k)
+        {
+            sum += ensemble.position(k)[0];
+            sum_squares += square(ensemble.position(k)[0]);
+            ++count;
+        }
+    }
+
+    const double mean = sum / static_cast<double>(count);
+    const double variance = sum_squares / static_cast<double>(count) - mean*mean;
+
+    BOOST_TEST(std::abs(mean) < 0.15);
+    BOOST_TEST(std::abs(variance - 1.0) < 0.2);
+    BOOST_TEST(ensemble.acceptance_fraction() > 0.2);
+    BOOST_TEST(ensemble.swap_fraction() > 0.0);
+
+    // Not enough walkers to span the parameter space
+    BOOST_CHECK_THROW(Tempered_ensemble<2>(std::vector<Point>(2, Point{0.0, 0.0}), 1, 2.0, log_prior, log_likelihood), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE(
+    joint_fit_stacked_residuals,
+    * boost::unit_test::label("joint")
+    * boost::unit_test::label("heuzey"))
+{
+    auto system = std::make_shared<System>();
+    system->T = 1.0;
+    system->rho = 1.0;
+
+    const auto time = Time_range::generate_exponential(1.5, 1e5);
+
+    std::vector<std::shared_ptr<Context>> contexts;
+    std::vector<std::unique_ptr<ICS_context_builder>> builders;
+    std::vector<ICS_result> results;
+    std::vector<Time_series::value_type> data;
+    results.reserve(2);
+
+    for (double N : {100.0, 200.0})
+    {
+        contexts.push_back(std::make_shared<Context>());
+        contexts.back()->N = N;
+        contexts.back()->N_e = 10;
+        contexts.back()->tau_monomer = 1;
+
+        builders.push_back(std::make_unique<ICS_context_builder>(system, contexts.back()));
+        results.emplace_back(time, builders.back().get(), constraint_release::impl::HEUZEY);
+        results.back().calculate();
+        data.push_back(results.back().get_values());
+    }
+
+    using Joint = Joint_fit<2>;
+
+    const std::vector<Joint::Dataset> datasets{{&data[0], &results[0]}, {&data[1], &results[1]}};
+    const std::vector<size_t> offsets{0, data[0].size()};
+    const std::vector<size_t> indices{0, 1};
+    const Joint::Transforms transforms{std::make_shared<Identity_transform>(), std::make_shared<Identity_transform>()};
+    const Joint::Assign assign = [](const Joint::Parameters& p, Context& c) { c.N_e = p[0]; c.tau_monomer = p[1]; };
+
+    Joint::User_data userdata{&datasets, &offsets, &indices, &transforms, &assign};
+
+    const size_t n = data[0].size() + data[1].size();
+    gsl_vector* f = gsl_vector_alloc(n);
+    gsl_vector* x = gsl_vector_alloc(2);
+
+    // At the parameters the data was generated with both data sets fit exactly
+    gsl_vector_set(x, 0, 10.0);
+    gsl_vector_set(x, 1, 1.0);
+    BOOST_TEST(Joint::joint_func(x, &userdata, f) == GSL_SUCCESS);
+
+    for (size_t j = 0 ; j < n ; ++j)
+        BOOST_TEST(gsl_vector_get(f, j) == 0.0, boost::test_tools::tolerance(1e-12));
+
+    // Changing a shared parameter moves the residuals of both data sets
+    gsl_vector_set(x, 0, 12.0);
+    Joint::joint_func(x, &userdata, f);
+
+    BOOST_TEST(std::abs(gsl_vector_get(f, n/4)) + std::abs(gsl_vector_get(f, data[0].size() - 1)) > 0.0);
+    BOOST_TEST(std::abs(gsl_vector_get(f, n - 1)) > 0.0);
+    BOOST_TEST(contexts[1]->N_e == 12.0);
+    BOOST_TEST(contexts[1]->N == 200.0);
+
+    gsl_vector_free(x);
+    gsl_vector_free(f);
+}
+
+BOOST_AUTO_TEST_CASE(
+    information_criteria,
+    * boost::unit_test::label("postprocess"))
+{
+    // n ln(rss/n) + 2k and n ln(rss/n) + k ln(n)
+    BOOST_CHECK_CLOSE(AIC(100.0, 100, 2), 4.0, 1e-8);
+    BOOST_CHECK_CLOSE(BIC(100.0, 100, 2), 2.0*std::log(100.0), 1e-8);
+
+    // A better fit with the same free variables ranks lower on both
+    BOOST_TEST(AIC(50.0, 100, 2) < AIC(100.0, 100, 2));
+    BOOST_TEST(BIC(50.0, 100, 3) - BIC(100.0, 100, 3) == AIC(50.0, 100, 3) - AIC(100.0, 100, 3), boost::test_tools::tolerance(1e-12));
+}
+
+BOOST_AUTO_TEST_CASE(
+    chebyshev_emulator,
+    * boost::unit_test::label("surrogate"))
+{
+    using Point = Chebyshev_emulator<2>::Point;
+
+    // A relaxation b exp(-t/a), smooth in the logarithm of its parameters
+    auto model = [](const Point& point, double* out) {
+        for (size_t t = 0 ; t < 5 ; ++t)
+            out[t] = point[1] * std::exp(-static_cast<double>(t) / point[0]);
+    };
+
+    Chebyshev_emulator<2> emulator({Bounds{1.0, 10.0}, Bounds{0.5, 2.0}}, 12, 5, 3, [&model](size_t, const Point& point, double* out) { model(point, out); });
+
+    BOOST_TEST(emulator.nodes() == 169u);
+
+    std::array<double, 5> exact, emulated;
+
+    model({3.3, 1.7}, exact.data());
+    emulator({3.3, 1.7}, emulated.data());
+
+    for (size_t t = 0 ; t < 5 ; ++t)
+        BOOST_CHECK_CLOSE(emulated[t], exact[t], 1e-6);
+
+    // Points outside of the box are clamped onto it
+    std::array<double, 5> clamped;
+
+    emulator({100.0, 1.7}, clamped.data());
+    model({10.0, 1.7}, exact.data());
+
+    for (size_t t = 0 ; t < 5 ; ++t)
+        BOOST_CHECK_CLOSE(clamped[t], exact[t], 1e-6);
+
+    BOOST_CHECK_THROW(Chebyshev_emulator<2>({Bounds{0.0, 10.0}, Bounds{0.5, 2.0}}, 4, 5, 1, [](size_t, const Point&, double*) {}), std::runtime_error);
+    BOOST_CHECK_THROW(Chebyshev_emulator<2>({Bounds{1.0, 10.0}, Bounds{0.5, 2.0}}, Chebyshev_emulator<2>::max_order, 5, 1, [](size_t, const Point&, double*) {}), std::runtime_error);
+}